@@ -0,0 +1,115 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// ARQ
+//*******************************************************
+#ifndef ARQ_H
+#define ARQ_H
+#pragma once
+
+
+#include <stdint.h>
+#include <string.h>
+
+
+//-------------------------------------------------------
+// ARQ, retransmission of serial payload
+//-------------------------------------------------------
+// simple stop-and-wait scheme using the seq_no and ack bits in the frame status
+// - ack = 1 in a frame says that the last frame from the other side was received with valid payload
+// - the seq no is only advanced if the last normal frame was acked, otherwise its payload is resent
+// - a received payload with the same seq no as the last accepted one is a retransmission and is dropped
+// cmd frames are not part of it, their ack is ignored and they don't touch the seq no bookkeeping
+// Tx and Rx must both have USE_ARQ set, or both not
+
+template <uint8_t PAYLOAD_LEN>
+class ArqBase
+{
+  public:
+    void Init(void)
+    {
+        Reset();
+    }
+
+    void Reset(void) // called then not connected
+    {
+        payload_len = 0;
+        payload_pending = false;
+        last_transmit_was_normal = false;
+
+        received_valid = false;
+        received_seq_no_last = UINT8_MAX;
+    }
+
+    //-- transmit side
+
+    // called before a frame is transmitted, ack is from the last frame received from the other side
+    void HandleAck(uint8_t ack)
+    {
+        if (last_transmit_was_normal && ack) payload_pending = false;
+    }
+
+    // true if the last payload was not yet acked and must be resent
+    bool PayloadPending(void)
+    {
+        return payload_pending;
+    }
+
+    // called then a normal frame with a new payload is transmitted
+    // an empty payload is not resent, there is nothing to lose
+    void SetPayload(uint8_t* _payload, uint8_t len)
+    {
+        if (len > PAYLOAD_LEN) len = PAYLOAD_LEN; // should not happen
+        memcpy(payload, _payload, len);
+        payload_len = len;
+        payload_pending = (len > 0);
+    }
+
+    uint8_t GetPayload(uint8_t* _payload)
+    {
+        memcpy(_payload, payload, payload_len);
+        return payload_len;
+    }
+
+    void SetTransmitFrameType(bool is_normal)
+    {
+        last_transmit_was_normal = is_normal;
+    }
+
+    // the ack to be send in the next frame
+    uint8_t Ack(void)
+    {
+        return (received_valid) ? 1 : 0;
+    }
+
+    //-- receive side
+
+    // called for each frame slot, valid = frame received with valid payload
+    void SetReceived(bool valid)
+    {
+        received_valid = valid;
+    }
+
+    // called for received normal frames with valid payload, returns false if it is a retransmission
+    bool AcceptPayload(uint8_t seq_no)
+    {
+        if (seq_no == received_seq_no_last) return false;
+        received_seq_no_last = seq_no;
+        return true;
+    }
+
+  private:
+    uint8_t payload[PAYLOAD_LEN];
+    uint8_t payload_len;
+    bool payload_pending;
+    bool last_transmit_was_normal;
+
+    bool received_valid;
+    uint8_t received_seq_no_last;
+};
+
+
+#endif // ARQ_H
@@ -22,7 +22,7 @@ void clock_reset(void);
 extern SX_DRIVER sx;
 extern SX2_DRIVER sx2;
 
-void sxReadFrame(uint8_t antenna, void* data, void* data2, uint8_t len);
+uint8_t sxReadFrame(uint8_t antenna, void* data, void* data2, uint8_t len);
 void sxSendFrame(uint8_t antenna, void* data, uint8_t len, uint16_t tmo_ms);
 void sxGetPacketStatus(uint8_t antenna, Stats* stats);
 
@@ -19,10 +19,15 @@
 #include "frame_types.h"
 #include "link_types.h"
 #include "common_stats.h"
+#include "arq.h"
 #include "bind.h"
 #include "fail.h"
 #include "buzzer.h"
 #include "fan.h"
+#include "power_control.h"
+#include "mode_adaptive.h"
+#include "rc_latency.h"
+#include "profiler.h"
 
 
 //-------------------------------------------------------
@@ -189,24 +194,35 @@ SX2_DRIVER sx2;
 
 Stats stats;
 
+#ifdef DEVICE_IS_RECEIVER
+ArqBase<FRAME_RX_PAYLOAD_LEN> arq;
+#endif
+#ifdef DEVICE_IS_TRANSMITTER
+ArqBase<FRAME_TX_PAYLOAD_LEN> arq;
+#endif
+
 FhssBase fhss;
 
 BindBase bind;
 
 tBuzzer buzzer;
 tFan fan;
+tPowerControl powerctrl;
+tModeAdaptive modeadapt;
+tRcLatency rclatency;
+tProfiler profiler;
 
 
 //-------------------------------------------------------
 // Sx/Sx2 convenience wrapper
 //-------------------------------------------------------
 
-void sxReadFrame(uint8_t antenna, void* data, void* data2, uint8_t len)
+uint8_t sxReadFrame(uint8_t antenna, void* data, void* data2, uint8_t len)
 {
     if (antenna == ANTENNA_1) {
-        sx.ReadFrame((uint8_t*)data, len);
+        return sx.ReadFrame((uint8_t*)data, len);
     } else {
-        sx2.ReadFrame((uint8_t*)data2, len);
+        return sx2.ReadFrame((uint8_t*)data2, len);
     }
 }
 
@@ -297,8 +313,10 @@ STATIC_ASSERT(sizeof(tRxFrame) == FRAME_TX_RX_LEN, "tRxFrame len missmatch")
 STATIC_ASSERT(sizeof(tTxBindFrame) == FRAME_TX_RX_LEN, "tTxBindFrame len missmatch")
 STATIC_ASSERT(sizeof(tRxBindFrame) == FRAME_TX_RX_LEN, "tRxBindFrame len missmatch")
 
-STATIC_ASSERT(sizeof(tTxCmdFrameRxParams) == FRAME_TX_PAYLOAD_LEN, "tTxCmdFrameRxParams len missmatch")
-STATIC_ASSERT(sizeof(tRxCmdFrameRxSetupData) == FRAME_RX_PAYLOAD_LEN, "tRxCmdFrameRxSetupData len missmatch")
+STATIC_ASSERT(sizeof(tTxCmdFrameRxParams) == FRAME_TX_PAYLOAD_LEN + FRAME_FEC_LEN, "tTxCmdFrameRxParams len missmatch")
+STATIC_ASSERT(sizeof(tRxCmdFrameRxSetupData) == FRAME_RX_PAYLOAD_LEN + FRAME_FEC_LEN, "tRxCmdFrameRxSetupData len missmatch")
+STATIC_ASSERT(FRAME_TX_PAYLOAD_LEN <= 15 * (FRAME_TX_PAYLOAD_LEN - (FRAME_TX_RX_LEN - FRAME_TX_RX_SLIM_LEN) - CMD_CHUNK_HEADER_LEN), "FRAME_TX_RX_SLIM_LEN too small")
+STATIC_ASSERT(LQ_AVERAGING_MS / FRAME_RATE_MS_MIN <= LQ_COUNTER_PERIOD_MAX, "LQ_AVERAGING_MS too large")
 
 STATIC_ASSERT(sizeof(tRxSetup) == 36, "tRxSetup len missmatch")
 STATIC_ASSERT(sizeof(tTxSetup) == 20, "tTxSetup len missmatch")
@@ -23,6 +23,66 @@
 // un-comment to enable Rx module to go into bind mode after power up
 //#define RX_BIND_MODE_AFTER_POWERUP
 
+// un-comment to enable retransmission of lost serial payload, Tx and Rx must have the same setting
+//#define USE_ARQ
+
+// un-comment to enable forward error correction, reduces serial payload per frame by FRAME_FEC_LEN bytes
+// Tx and Rx must have the same setting
+//#define USE_FEC
+
+// un-comment to enable transmitting frames only as long as their payload, shortens time over air
+// Tx and Rx must have the same setting, not supported by SX127x
+//#define USE_VARIABLE_FRAME_LEN
+
+// un-comment to enable packing of whole MAVLink messages into frames, in MAVLink mode
+//#define USE_MAVLINK_PACKING
+
+// un-comment to enable compression of MAVLink v2 headers over the link, requires USE_MAVLINK_PACKING
+// Tx and Rx must have the same setting
+//#define USE_MAVLINK_COMPRESSION
+
+// un-comment to enable swapping of chronically bad channels in the fhss list, is decided by the Tx
+// Rx firmware must support it
+//#define USE_FHSS_ADAPTIVE
+
+// un-comment to enable dynamic power, power is reduced while the link margin is large, Setup Power is the max power
+// Rx firmware must support it for the Tx to show the actual Rx power
+//#define USE_DYNAMIC_POWER
+
+// un-comment to enable on-the-fly switching between 50 Hz, 31 Hz, 19 Hz modes depending on the link quality
+// Setup Mode is the fastest mode, Tx and Rx must have the same setting
+//#define USE_MODE_ADAPTIVE
+
+// un-comment to enable the black box on the Tx, which records the last frames, dump with "bbdump" in the CLI
+// needs ca 3 kB RAM
+//#define USE_BLACKBOX
+
+// un-comment to enable measuring the rc latency from Tx input to Rx output, view with "lat" in the CLI
+// Tx and Rx must have the same setting
+//#define USE_RC_LATENCY
+
+// un-comment to enable the Tx to cache the MAVLink parameters of the vehicle, and to answer parameter requests
+// of the GCS locally, view with "pcache" in the CLI, needs ca 20 kB RAM, not for Tx with 32 kB RAM or less
+//#define USE_MAVLINK_PARAM_CACHE
+
+// un-comment to enable the Rx to tune the MAVLink stream rates of the autopilot to the link capacity
+//#define USE_MAVLINK_STREAM_TUNING
+
+// un-comment to enable the Rx to send MAVLink messages from the flight controller by priority, and to drop
+// stale samples of telemetry streams instead of queuing them
+//#define USE_MAVLINK_SCHEDULER
+
+// un-comment to enable the Rx to use a controller on the rate and queue depth for the RADIO_STATUS txbuf flow
+// control, instead of the txbuf state machines, see tools/run_txbuf_simulation.py for a comparison
+//#define USE_MAVLINK_TXBUF_CONTROLLER
+
+// un-comment to enable the Tx to report the fill level of the serial buffer to the GCS with RADIO_STATUS txbuf,
+// view with "uplink" in the CLI
+//#define USE_MAVLINK_UPLINK_FLOW_CONTROL
+
+// un-comment to enable the main loop profiler, view with "perf" in the Tx CLI, the Rx prints to debug
+//#define USE_PROFILER
+
 
 //-------------------------------------------------------
 // Setup
@@ -88,6 +148,7 @@
 #define SETUP_MODE                      MODE_50HZ
 //#define SETUP_MODE                      MODE_31HZ
 //#define SETUP_MODE                      MODE_19HZ
+//#define SETUP_MODE                      MODE_100HZ
 
 
 //#define SETUP_RF_BAND                    SETUP_FREQUENCY_BAND_915_MHZ_FCC
@@ -105,6 +166,7 @@
 #define MODE_31HZ_SEND_FRAME_TMO_MS           15 // just needs to be larger than toa, not critical
 #define MODE_19HZ_SEND_FRAME_TMO_MS           25 // just needs to be larger than toa, not critical
 #define MODE_FLRC_SEND_FRAME_TMO_MS           3  // just needs to be larger than toa, not critical
+#define MODE_100HZ_SEND_FRAME_TMO_MS          5  // just needs to be larger than toa, not critical
 
 #define FHSS_NUM_BAND_433_MHZ                 2 // 2 since 1 is needed for bind
 #define FHSS_NUM_BAND_70_CM_HAM_19HZ_MODE     12 // to match 2.4 GHz at 19 Hz
@@ -117,12 +179,21 @@
 #define FHSS_NUM_BAND_2P4_GHZ                 24
 
 #define FRAME_TX_RX_LEN                 91 // we currently only support equal len
+#define FRAME_TX_RX_SLIM_LEN            40 // used by the 100 Hz mode
 
 #define CONNECT_TMO_MS                  1250 // time to disconnect, was 500, then 750 to better handle 19 Hz mode, now 1250
 
 #define CONNECT_SYNC_CNT                5 // number of packets to connect
 
-#define LQ_AVERAGING_MS                 1000
+#define LQ_AVERAGING_MS                 1000 // the resulting number of frames must not exceed 255
+#define FRAME_RATE_MS_MIN               7 // frame period of the fastest mode, is used to check LQ_AVERAGING_MS
+
+#define POWER_CONTROL_MARGIN_DB         30 // dynamic power, target margin of the rssi above receiver sensitivity
+#define POWER_CONTROL_HYSTERESIS_DB     6
+
+#define MODE_ADAPTIVE_LQ_DOWN           70 // adaptive mode, LQ below which the next slower mode is used
+#define MODE_ADAPTIVE_LQ_UP             95 // LQ and rssi margin above which the next faster mode is used
+#define MODE_ADAPTIVE_MARGIN_UP_DB      15
 
 
 #define TX_SERIAL_BAUDRATE              115200 // will be overwritten by setup
@@ -162,6 +162,7 @@ uint8_t crsf_cvt_mode(uint8_t mode)
     if (mode == MODE_31HZ) return 31;
     if (mode == MODE_50HZ) return CRSF_RFMODE_50_HZ;
     if (mode == MODE_FLRC_DEV) return 143;
+    if (mode == MODE_100HZ) return 100;
     return UINT8_MAX;
 }
 
@@ -172,6 +173,7 @@ uint8_t crsf_cvt_fps(uint8_t mode)
     if (mode == MODE_31HZ) return 3;
     if (mode == MODE_50HZ) return 5;
     if (mode == MODE_FLRC_DEV) return 14;
+    if (mode == MODE_100HZ) return 10;
     return UINT8_MAX;
 }
 
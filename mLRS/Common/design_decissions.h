@@ -719,6 +719,19 @@ method C:
   we could speed up adaption by increasing radio_status rate by two when +60ms or -40ms
   but it works very well for me as is
 
+method D, USE_MAVLINK_TXBUF_CONTROLLER:
+  a controller on the incoming rate and the queue delay, see mavlink_txbuf_controller.h
+  the queue is the integral of rate minus link capacity, so it gives the I term for free
+  radio_status is send at a fixed 4 Hz, params are cut immediately when the queue builds up
+  tools/run_txbuf_simulation.py simulates ArduPilot and PX4 with method C/B and D for all modes and baudrates
+  in the simulation it keeps the queue delay lower, avoids the overflows of method C in 19 Hz mode,
+  and lets param downloads complete also when the streams load the link, PX4 goodput is somewhat lower
+  the autopilots' steps are fixed, so at low capacity the loop gain is higher, below 5000 B/s the rate filter
+  is slowed and the weak dead band widened, with this the autopilot's rate reverses at most 2 times/min in
+  19 Hz mode, vs 4 - 26 times/min with method C/B
+  regression: in 19 Hz mode PX4 gets ca 20% less stream throughput than with method B (ca 980 vs 1250 B/s),
+  since the PX4 recovery step of x1.025 is slow and the wider dead band holds the rate lower
+
 
 -------------------------------------------------------
 some experimental results
@@ -101,6 +101,13 @@ void FhssBase::generate(uint32_t seed)
     for (uint8_t k = 0; k < cnt; k++) {
         fhss_last_rssi[k] = INT8_MIN;
     }
+
+    // adaptive fhss
+    for (uint8_t k = 0; k < cnt; k++) ch_list_generated[k] = ch_list[k];
+    for (uint8_t n = 0; n < sizeof(ch_bad); n++) ch_bad[n] = 0;
+    swap_cnt = 0;
+    swap_pending_i = UINT8_MAX;
+    clear_hop_stats();
 }
 
 
@@ -206,5 +213,116 @@ void FhssBase::generate_ortho_except(uint32_t seed, uint8_t ortho, uint8_t excep
     for (uint8_t k = 0; k < cnt; k++) {
         fhss_last_rssi[k] = INT8_MIN;
     }
+
+    // adaptive fhss
+    for (uint8_t k = 0; k < cnt; k++) ch_list_generated[k] = ch_list[k];
+    for (uint8_t n = 0; n < sizeof(ch_bad); n++) ch_bad[n] = 0;
+    swap_cnt = 0;
+    swap_pending_i = UINT8_MAX;
+    clear_hop_stats();
+}
+
+
+
+//-------------------------------------------------------
+// adaptive fhss
+//-------------------------------------------------------
+
+void FhssBase::swap_channel(void)
+{
+    uint8_t i = swap_pending_i;
+    swap_pending_i = UINT8_MAX;
+
+    ch_bad[ch_list[i] / 8] |= (1 << (ch_list[i] % 8));
+    ch_list[i] = swap_pending_ch;
+    fhss_list[i] = fhss_freq_list[swap_pending_ch];
+    fhss_last_rssi[i] = INT8_MIN;
+    swap_cnt++;
+
+    clear_hop_stats();
+}
+
+
+void FhssBase::clear_hop_stats(void)
+{
+    for (uint8_t k = 0; k < cnt; k++) hop_valid_cnt[k] = 0;
+    hop_cycle_cnt = 0;
+    swap_i = UINT8_MAX;
+}
+
+
+// finds the worst hop, and marks it for swap if it is well below the others
+void FhssBase::evaluate_hop_stats(void)
+{
+    uint16_t valid_sum = 0;
+    uint8_t i_worst = 0;
+
+    for (uint8_t k = 0; k < cnt; k++) {
+        valid_sum += hop_valid_cnt[k];
+        if (hop_valid_cnt[k] < hop_valid_cnt[i_worst]) i_worst = k;
+    }
+
+    uint8_t LQ = ((uint32_t)valid_sum * 100) / ((uint16_t)cnt * FHSS_ADAPT_PERIOD);
+    uint8_t LQ_worst = ((uint16_t)hop_valid_cnt[i_worst] * 100) / FHSS_ADAPT_PERIOD;
+
+    clear_hop_stats();
+
+    if (LQ >= FHSS_ADAPT_LQ_MIN && LQ_worst + FHSS_ADAPT_LQ_MARGIN < LQ) swap_i = i_worst;
 }
 
+
+// checks the same constraints as generate_ortho_except()
+bool FhssBase::is_allowed_channel(uint8_t ch)
+{
+    for (uint8_t bi = 0; bi < BIND_CHANNEL_LIST_LEN; bi++) {
+        if (ch == fhss_bind_channel_list[bi]) return false;
+    }
+
+    if (_ortho >= FHSS_ORTHO_1_3 && _ortho <= FHSS_ORTHO_3_3) {
+        if ((ch % 3) != (_ortho - FHSS_ORTHO_1_3)) return false;
+        if (ch / 3 >= FREQ_LIST_LEN / 3) return false;
+    }
+
+#ifdef FHSS_HAS_CONFIG_2P4_GHZ
+    uint32_t freq = fhss_freq_list[ch];
+    switch (_except) {
+    case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_1:
+        if (SX1280_FREQ_GHZ_TO_REG(2.401) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.423)) return false;
+        break;
+    case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_6:
+        if (SX1280_FREQ_GHZ_TO_REG(2.426) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.448)) return false;
+        break;
+    case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_11:
+        if (SX1280_FREQ_GHZ_TO_REG(2.451) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.473)) return false;
+        break;
+    case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_13:
+        if (SX1280_FREQ_GHZ_TO_REG(2.461) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.483)) return false;
+        break;
+    }
+#endif
+
+    return true;
+}
+
+
+// returns UINT8_MAX if there is no unused channel left
+uint8_t FhssBase::find_unused_channel(void)
+{
+    uint8_t ch_start = prng() % FREQ_LIST_LEN; // start at a random place
+
+    for (uint8_t n = 0; n < FREQ_LIST_LEN; n++) {
+        uint8_t ch = (ch_start + n) % FREQ_LIST_LEN;
+
+        if (ch_bad[ch / 8] & (1 << (ch % 8))) continue;
+
+        bool is_used = false;
+        for (uint8_t k = 0; k < cnt; k++) {
+            if (ch_list[k] == ch) { is_used = true; break; }
+        }
+        if (is_used) continue;
+
+        if (is_allowed_channel(ch)) return ch;
+    }
+
+    return UINT8_MAX;
+}
@@ -22,6 +22,10 @@
 #define FHSS_MAX_NUM            32
 #define FHSS_FREQ_LIST_MAX_LEN  86 // 2.4 GHz is 80
 
+#define FHSS_ADAPT_PERIOD       32 // number of fhss cycles over which the hop statistics is taken
+#define FHSS_ADAPT_LQ_MIN       50 // the link LQ must be at least this, else we are rather at range limit
+#define FHSS_ADAPT_LQ_MARGIN    30 // a hop is bad if its LQ is by this below the link LQ
+
 //-------------------------------------------------------
 // Frequency list
 //-------------------------------------------------------
@@ -543,6 +547,8 @@ class FhssBase
     {
         curr_i++;
         if (curr_i >= cnt) curr_i = 0;
+
+        if (curr_i == swap_pending_i) swap_channel(); // both sides swap as they hop onto it
     }
 
     void SetToBind(uint16_t frame_rate_ms = 1) // preset so it is good for transmitter
@@ -598,6 +604,73 @@ class FhssBase
         return fhss_list[curr_i];
     }
 
+    //-- adaptive fhss
+    // per hop statistics is taken, and chronically bad channels are swapped for unused channels
+    // the Tx decides, the swap is synchronized with the Rx by the FHSS_SWAP cmd frame
+    // the swap is not done on receipt, but by both sides when they next hop onto the hop, so a lost
+    // FHSS_SWAP_ACK can't leave the lists different
+    // a reset restores the generated list, which is done on both sides then not connected
+
+    // called once per frame, before hopping
+    void SetHopStats(bool valid, int8_t rssi)
+    {
+        if (is_in_binding) return;
+
+        if (valid) {
+            hop_valid_cnt[curr_i]++;
+            fhss_last_rssi[curr_i] = rssi;
+        }
+
+        if (curr_i < cnt - 1) return;
+        hop_cycle_cnt++;
+        if (hop_cycle_cnt >= FHSS_ADAPT_PERIOD) evaluate_hop_stats();
+    }
+
+    // only used by transmitter, true if a bad channel should be swapped
+    // is only true right after the bad hop was used, to leave time for the swap before it is used again
+    bool GetChannelSwap(uint8_t* fhss_i, uint8_t* ch)
+    {
+        if (swap_i == UINT8_MAX || swap_i != curr_i) return false;
+
+        uint8_t new_ch = find_unused_channel();
+        if (new_ch == UINT8_MAX) { swap_i = UINT8_MAX; return false; } // no channel left
+
+        *fhss_i = swap_i;
+        *ch = new_ch;
+        swap_i = UINT8_MAX;
+        return true;
+    }
+
+    // schedules the swap, it is done in HopToNext()
+    void SetChannelSwap(uint8_t fhss_i, uint8_t ch)
+    {
+        if (fhss_i >= cnt || ch >= FREQ_LIST_LEN) return; // should not happen, but play it safe
+        if (ch_list[fhss_i] == ch) return; // already done
+
+        swap_pending_i = fhss_i;
+        swap_pending_ch = ch;
+    }
+
+    bool ChannelSwapPending(void)
+    {
+        return (swap_pending_i != UINT8_MAX);
+    }
+
+    void ResetSwaps(void)
+    {
+        swap_pending_i = UINT8_MAX;
+        if (!swap_cnt) return;
+
+        for (uint8_t k = 0; k < cnt; k++) {
+            ch_list[k] = ch_list_generated[k];
+            fhss_list[k] = fhss_freq_list[ch_list[k]];
+            fhss_last_rssi[k] = INT8_MIN;
+        }
+        swap_cnt = 0;
+
+        clear_hop_stats();
+    }
+
   private:
     uint32_t _seed;
     uint8_t _ortho;
@@ -616,6 +689,21 @@ class FhssBase
 
     int8_t fhss_last_rssi[FHSS_MAX_NUM];
 
+    uint8_t ch_list_generated[FHSS_MAX_NUM];
+    uint8_t ch_bad[(FHSS_FREQ_LIST_MAX_LEN + 7) / 8]; // channels which have been swapped out
+    uint8_t hop_valid_cnt[FHSS_MAX_NUM];
+    uint8_t hop_cycle_cnt;
+    uint8_t swap_i;
+    uint8_t swap_cnt;
+    uint8_t swap_pending_i;
+    uint8_t swap_pending_ch;
+
+    void swap_channel(void);
+    void clear_hop_stats(void);
+    void evaluate_hop_stats(void);
+    bool is_allowed_channel(uint8_t ch);
+    uint8_t find_unused_channel(void);
+
     bool is_in_binding;
     uint8_t curr_bind_config_i;
     uint16_t bind_listen_cnt;
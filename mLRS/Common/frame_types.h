@@ -12,6 +12,7 @@
 
 
 #include <inttypes.h>
+#include "common_conf.h"
 
 
 #ifndef PACKED
@@ -46,11 +47,19 @@ typedef struct
 } tFrameStats;
 
 
+// with FEC, the last FRAME_FEC_LEN bytes of the payload field hold the Reed-Solomon parity
+
+#ifdef USE_FEC
+#define FRAME_FEC_LEN           4 // corrects up to 2 byte errors
+#else
+#define FRAME_FEC_LEN           0
+#endif
+
 #define FRAME_TX_RX_HEADER_LEN  7
 #define FRAME_TX_RCDATA1_LEN    6
 #define FRAME_TX_RCDATA2_LEN    10
-#define FRAME_TX_PAYLOAD_LEN    64 // 82 - 10-6(rcdata) - 2(crc) = 64
-#define FRAME_RX_PAYLOAD_LEN    82
+#define FRAME_TX_PAYLOAD_LEN    (64 - FRAME_FEC_LEN) // 82 - 10-6(rcdata) - 2(crc) = 64
+#define FRAME_RX_PAYLOAD_LEN    (82 - FRAME_FEC_LEN)
 
 
 PACKED(
@@ -107,7 +116,7 @@ typedef struct
     tFrameRcData1 rc1; // 6 bytes
     uint16_t crc1;
     tFrameRcData2 rc2; // 10 bytes
-    uint8_t payload[64]; // = FRAME_TX_PAYLOAD_LEN
+    uint8_t payload[64]; // = FRAME_TX_PAYLOAD_LEN + FRAME_FEC_LEN
     uint16_t crc;
 }) tTxFrame; // 91 bytes
 
@@ -119,7 +128,7 @@ typedef struct
 {
     uint16_t sync_word; // 2 bytes
     tFrameStatus status; // 5 bytes
-    uint8_t payload[82]; // = FRAME_RX_PAYLOAD_LEN
+    uint8_t payload[82]; // = FRAME_RX_PAYLOAD_LEN + FRAME_FEC_LEN
     uint16_t crc;
 }) tRxFrame; // 91 bytes
 
@@ -188,6 +197,12 @@ typedef enum {
     FRAME_CMD_SET_RX_PARAMS,            // tx -> rx, set parameters -> response with RX_ACK
     FRAME_CMD_STORE_RX_PARAMS,          // tx -> rx, ask to store parameters -> response with RX_SETUPDATA
     FRAME_CMD_GET_RX_SETUPDATA_WRELOAD,
+    FRAME_CMD_FHSS_SWAP,                // tx -> rx, swap a channel in the fhss list -> response with FHSS_SWAP_ACK
+    FRAME_CMD_FHSS_SWAP_ACK,            // rx -> tx, confirm the swap
+    FRAME_CMD_RX_POWER,                 // rx -> tx, report actual power, with dynamic power
+    FRAME_CMD_MODE_SWITCH,              // tx -> rx, switch mode in cnt frames, is repeated until the switch -> response with MODE_SWITCH_ACK
+    FRAME_CMD_MODE_SWITCH_ACK,          // rx -> tx, confirm that the announcement was received
+    FRAME_CMD_RX_RC_LATENCY,            // rx -> tx, report rc latency statistics
 } FRAME_CMD_ENUM;
 
 
@@ -250,7 +265,7 @@ typedef struct
     uint8_t OutMode_allowed_mask;
     uint8_t Buzzer_allowed_mask;
 
-    uint8_t spare3[5];
+    uint8_t spare3[5]; // the last FRAME_FEC_LEN bytes are taken by FEC, so must stay spare
 }) tRxCmdFrameRxSetupData; // 82 bytes
 
 
@@ -272,10 +287,56 @@ typedef struct
 
     tCmdFrameRxParameters RxParams; // 24 bytes
 
-    uint8_t spare3[28];
+    uint8_t spare3[28]; // the last FRAME_FEC_LEN bytes are taken by FEC, so must stay spare
 }) tTxCmdFrameRxParams; // 64 bytes
 
 
+// send from Tx to do FHSS_SWAP, and from Rx as response with FHSS_SWAP_ACK
+PACKED(
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t fhss_i; // index into the fhss list
+    uint8_t ch; // new channel, index into the frequency list of the band
+}) tCmdFrameFhssSwap; // 3 bytes
+
+
+// send from Rx to report its actual power
+PACKED(
+typedef struct
+{
+    uint8_t cmd;
+    int8_t actual_power_dbm;
+}) tRxCmdFrameRxPower; // 2 bytes
+
+
+// send from Tx to do MODE_SWITCH, in each frame until the switch, with cnt counting down,
+// and from Rx as response with MODE_SWITCH_ACK
+PACKED(
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t mode; // new mode
+    uint8_t cnt; // number of frames until the switch, the switch is done before the frame cnt frames later
+    uint8_t confirmed; // 1: the Tx got the ack and will switch, the Rx switches only then
+}) tCmdFrameModeSwitch; // 4 bytes
+
+
+// send from Rx to report the rc latency statistics
+PACKED(
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t spare;
+    uint16_t cnt; // number of rc data outputs in the report period
+    uint16_t min_us;
+    uint16_t avg_us;
+    uint16_t max_us;
+    uint16_t std_us;
+    uint8_t hist[16]; // in %, RC_LATENCY_HIST_BIN_US wide bins
+}) tRxCmdFrameRcLatency; // 28 bytes
+
+
 // for type casting to get the header
 PACKED(
 typedef struct
@@ -12,6 +12,10 @@
 
 
 #include "frame_types.h"
+#include "libs/crc16.h"
+#ifdef USE_FEC
+#include "libs/reed_solomon.h"
+#endif
 
 
 extern SX_DRIVER sx;
@@ -31,6 +35,54 @@ typedef enum {
 } CHECK_ENUM;
 
 
+#ifdef USE_FEC
+// the codeword is the frame with the crc moved in front of the parity, so that it is protected too
+// the parity sits in the last FRAME_FEC_LEN bytes of the payload field
+
+#define FRAME_FEC_PARITY_POS  (FRAME_TX_RX_LEN - 2 - FRAME_FEC_LEN)
+
+void _fec_frame_to_codeword(uint8_t* cw, uint8_t* frame)
+{
+    memcpy(cw, frame, FRAME_FEC_PARITY_POS);
+    cw[FRAME_FEC_PARITY_POS] = frame[FRAME_TX_RX_LEN - 2];
+    cw[FRAME_FEC_PARITY_POS + 1] = frame[FRAME_TX_RX_LEN - 1];
+    memcpy(cw + FRAME_FEC_PARITY_POS + 2, frame + FRAME_FEC_PARITY_POS, FRAME_FEC_LEN);
+}
+
+
+void _fec_codeword_to_frame(uint8_t* frame, uint8_t* cw)
+{
+    memcpy(frame, cw, FRAME_FEC_PARITY_POS);
+    frame[FRAME_TX_RX_LEN - 2] = cw[FRAME_FEC_PARITY_POS];
+    frame[FRAME_TX_RX_LEN - 1] = cw[FRAME_FEC_PARITY_POS + 1];
+    memcpy(frame + FRAME_FEC_PARITY_POS, cw + FRAME_FEC_PARITY_POS + 2, FRAME_FEC_LEN);
+}
+
+
+// to be called after the crc was set
+void fec_encode_frame(uint8_t* frame)
+{
+uint8_t cw[FRAME_TX_RX_LEN];
+
+    _fec_frame_to_codeword(cw, frame);
+    rs_encode(cw, FRAME_TX_RX_LEN, FRAME_FEC_LEN);
+    memcpy(frame + FRAME_FEC_PARITY_POS, cw + FRAME_FEC_PARITY_POS + 2, FRAME_FEC_LEN);
+}
+
+
+// returns false if the frame can't be repaired, frame is then not modified
+bool fec_decode_frame(uint8_t* frame)
+{
+uint8_t cw[FRAME_TX_RX_LEN];
+
+    _fec_frame_to_codeword(cw, frame);
+    if (!rs_decode(cw, FRAME_TX_RX_LEN, FRAME_FEC_LEN)) return false;
+    _fec_codeword_to_frame(frame, cw);
+    return true;
+}
+#endif
+
+
 void _pack_txframe_w_type(tTxFrame* frame, uint8_t type, tFrameStats* frame_stats, tRcData* rc, uint8_t* payload, uint8_t payload_len)
 {
 uint16_t crc;
@@ -79,12 +131,16 @@ uint16_t crc;
     }
 
     // finalize, crc
-    fmav_crc_init(&crc);
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN);
+    crc16_init(&crc);
+    crc16_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN);
     frame->crc1 = crc;
 
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame + FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN, FRAME_TX_RX_LEN - FRAME_TX_RX_HEADER_LEN - FRAME_TX_RCDATA1_LEN - 2);
+    crc16_accumulate_buf(&crc, (uint8_t*)frame + FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN, FRAME_TX_RX_LEN - FRAME_TX_RX_HEADER_LEN - FRAME_TX_RCDATA1_LEN - 2 - FRAME_FEC_LEN);
     frame->crc = crc;
+
+#ifdef USE_FEC
+    fec_encode_frame((uint8_t*)frame);
+#endif
 }
 
 
@@ -94,8 +150,7 @@ void pack_txframe(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc, uint8_
 }
 
 
-// returns 0 if OK !!
-uint8_t check_txframe(tTxFrame* frame)
+uint8_t _check_txframe(tTxFrame* frame)
 {
 uint16_t crc;
 
@@ -107,17 +162,38 @@ uint16_t crc;
 
     if (frame->status.payload_len > FRAME_TX_PAYLOAD_LEN) return CHECK_ERROR_HEADER;
 
-    fmav_crc_init(&crc);
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN);
+    crc16_init(&crc);
+    crc16_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN);
     if (crc != frame->crc1) return CHECK_ERROR_CRC1;
 
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame + FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN, FRAME_TX_RX_LEN - FRAME_TX_RX_HEADER_LEN - FRAME_TX_RCDATA1_LEN - 2);
+    crc16_accumulate_buf(&crc, (uint8_t*)frame + FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN, FRAME_TX_RX_LEN - FRAME_TX_RX_HEADER_LEN - FRAME_TX_RCDATA1_LEN - 2 - FRAME_FEC_LEN);
     if (crc != frame->crc) return CHECK_ERROR_CRC;
 
     return CHECK_OK;
 }
 
 
+// returns 0 if OK !!
+uint8_t check_txframe(tTxFrame* frame)
+{
+    uint8_t res = _check_txframe(frame);
+
+#ifdef USE_FEC
+    // try to repair, work on a copy so that a failed repair doesn't destroy e.g. a valid crc1 part
+    if (res != CHECK_OK) {
+        tTxFrame frame_fec;
+        memcpy(&frame_fec, frame, sizeof(tTxFrame));
+        if (fec_decode_frame((uint8_t*)&frame_fec) && (_check_txframe(&frame_fec) == CHECK_OK)) {
+            memcpy(frame, &frame_fec, sizeof(tTxFrame));
+            res = CHECK_OK;
+        }
+    }
+#endif
+
+    return res;
+}
+
+
 void rcdata_rc1_from_txframe(tRcData* rc, tTxFrame* frame)
 {
     rc->ch[0] = frame->rc1.ch0;
@@ -180,9 +256,13 @@ uint16_t crc;
         frame->payload[i] = payload[i];
     }
 
-    fmav_crc_init(&crc);
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_LEN - 2);
+    crc16_init(&crc);
+    crc16_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_LEN - 2 - FRAME_FEC_LEN);
     frame->crc = crc;
+
+#ifdef USE_FEC
+    fec_encode_frame((uint8_t*)frame);
+#endif
 }
 
 
@@ -191,8 +271,7 @@ void pack_rxframe(tRxFrame* frame, tFrameStats* frame_stats, uint8_t* payload, u
     _pack_rxframe_w_type(frame, FRAME_TYPE_RX, frame_stats, payload, payload_len);
 }
 
-// returns 0 if OK !!
-uint8_t check_rxframe(tRxFrame* frame)
+uint8_t _check_rxframe(tRxFrame* frame)
 {
 uint16_t crc;
 
@@ -204,14 +283,252 @@ uint16_t crc;
 
     if (frame->status.payload_len > FRAME_RX_PAYLOAD_LEN) return CHECK_ERROR_HEADER;
 
-    fmav_crc_init(&crc);
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_LEN - 2);
+    crc16_init(&crc);
+    crc16_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_LEN - 2 - FRAME_FEC_LEN);
     if (crc != frame->crc) return CHECK_ERROR_CRC;
 
     return CHECK_OK;
 }
 
 
+// returns 0 if OK !!
+uint8_t check_rxframe(tRxFrame* frame)
+{
+    uint8_t res = _check_rxframe(frame);
+
+#ifdef USE_FEC
+    // try to repair
+    if (res != CHECK_OK) {
+        tRxFrame frame_fec;
+        memcpy(&frame_fec, frame, sizeof(tRxFrame));
+        if (fec_decode_frame((uint8_t*)&frame_fec) && (_check_rxframe(&frame_fec) == CHECK_OK)) {
+            memcpy(frame, &frame_fec, sizeof(tRxFrame));
+            res = CHECK_OK;
+        }
+    }
+#endif
+
+    return res;
+}
+
+
+//-------------------------------------------------------
+// Frame Length
+//-------------------------------------------------------
+// frames are packed and checked with full length, with the unused payload bytes being zero
+// for sending, the tail (FEC parity and crc) is moved to directly follow the used payload
+// on reception it is moved back, and the gap filled with zeros, which restores the full frame
+// the frame length is Config.frame_len, which is shorter than FRAME_TX_RX_LEN for the slim frame modes,
+// with USE_VARIABLE_FRAME_LEN it is reduced further to the used payload
+
+#define FRAME_TAIL_LEN  (FRAME_FEC_LEN + 2)
+
+
+// returns the length of the frame to send
+uint8_t _frame_shrink(uint8_t* frame, uint8_t unused_len)
+{
+    if (!unused_len) return FRAME_TX_RX_LEN;
+
+    uint8_t len = FRAME_TX_RX_LEN - unused_len;
+    memmove(frame + len - FRAME_TAIL_LEN, frame + FRAME_TX_RX_LEN - FRAME_TAIL_LEN, FRAME_TAIL_LEN);
+    return len;
+}
+
+
+uint8_t txframe_shrink(tTxFrame* frame)
+{
+#ifdef USE_VARIABLE_FRAME_LEN
+    return _frame_shrink((uint8_t*)frame, FRAME_TX_PAYLOAD_LEN - frame->status.payload_len);
+#else
+    return _frame_shrink((uint8_t*)frame, FRAME_TX_RX_LEN - Config.frame_len);
+#endif
+}
+
+
+uint8_t rxframe_shrink(tRxFrame* frame)
+{
+#ifdef USE_VARIABLE_FRAME_LEN
+    return _frame_shrink((uint8_t*)frame, FRAME_RX_PAYLOAD_LEN - frame->status.payload_len);
+#else
+    return _frame_shrink((uint8_t*)frame, FRAME_TX_RX_LEN - Config.frame_len);
+#endif
+}
+
+
+// len is the number of received bytes, returns false if it can't be a valid frame
+bool _frame_expand(uint8_t* frame, uint8_t len, uint8_t min_len)
+{
+    if (len > Config.frame_len || len < min_len) return false;
+    if (len == FRAME_TX_RX_LEN) return true;
+
+    memmove(frame + FRAME_TX_RX_LEN - FRAME_TAIL_LEN, frame + len - FRAME_TAIL_LEN, FRAME_TAIL_LEN);
+    memset(frame + len - FRAME_TAIL_LEN, 0, FRAME_TX_RX_LEN - len);
+    return true;
+}
+
+
+bool txframe_expand(tTxFrame* frame, uint8_t len)
+{
+    return _frame_expand((uint8_t*)frame, len, FRAME_TX_RX_LEN - FRAME_TX_PAYLOAD_LEN);
+}
+
+
+bool rxframe_expand(tRxFrame* frame, uint8_t len)
+{
+    return _frame_expand((uint8_t*)frame, len, FRAME_TX_RX_LEN - FRAME_RX_PAYLOAD_LEN);
+}
+
+
+//-------------------------------------------------------
+// Cmd Frame Chunks
+//-------------------------------------------------------
+// cmd frames don't fit into slim frames, so their payload is send in chunks
+// each chunk starts with a header of CMD_CHUNK_HEADER_LEN bytes:
+// - chunk index (upper nibble) and number of chunks (lower nibble)
+// - length of the cmd payload
+// - crc16 of the cmd payload, low and high byte
+// cmd frames are repeated by the sender until the other side responds, so the sender simply cycles
+// through the chunks, and the receiver collects them until the cmd payload is complete
+// length and crc identify the cmd payload, the receiver starts over when they change, and checks the crc
+// of the reassembled payload, so chunks of different cmds can't get mixed up
+
+#define CMD_CHUNK_HEADER_LEN  4
+
+class CmdFrameChunker
+{
+  public:
+    void Init(void)
+    {
+        tx_idx = 0;
+        Reset();
+    }
+
+    void Reset(void) // called then a non-cmd frame was received
+    {
+        rx_cnt = 0;
+        rx_len = 0;
+        rx_crc = 0;
+        rx_mask = 0;
+    }
+
+    // chunk must have space for max_len bytes, returns the length of the chunk
+    uint8_t Pack(uint8_t* chunk, uint8_t max_len, uint8_t* payload, uint8_t len)
+    {
+        uint8_t data_len = max_len - CMD_CHUNK_HEADER_LEN;
+        uint8_t cnt = (len + data_len - 1) / data_len;
+        uint16_t crc = crc16_calculate(payload, len);
+
+        if (tx_idx >= cnt) tx_idx = 0;
+        uint8_t pos = tx_idx * data_len;
+        uint8_t n = (len - pos < data_len) ? len - pos : data_len;
+
+        chunk[0] = (tx_idx << 4) | cnt;
+        chunk[1] = len;
+        chunk[2] = crc;
+        chunk[3] = crc >> 8;
+        memcpy(&chunk[CMD_CHUNK_HEADER_LEN], &payload[pos], n);
+        tx_idx++;
+        return n + CMD_CHUNK_HEADER_LEN;
+    }
+
+    // payload_len is the size of payload, returns true once the cmd payload is complete
+    bool Unpack(uint8_t* payload, uint8_t payload_len, uint8_t* chunk, uint8_t max_len)
+    {
+        uint8_t data_len = max_len - CMD_CHUNK_HEADER_LEN;
+        uint8_t idx = chunk[0] >> 4;
+        uint8_t cnt = chunk[0] & 0x0F;
+        uint8_t len = chunk[1];
+        uint16_t crc = chunk[2] + ((uint16_t)chunk[3] << 8);
+
+        if (!len || len > payload_len) return false;
+        if (cnt != (len + data_len - 1) / data_len || idx >= cnt) return false;
+        uint8_t pos = idx * data_len;
+        uint8_t n = (len - pos < data_len) ? len - pos : data_len;
+
+        if (cnt != rx_cnt || len != rx_len || crc != rx_crc) { // a different cmd
+            rx_cnt = cnt;
+            rx_len = len;
+            rx_crc = crc;
+            rx_mask = 0;
+        }
+        memcpy(&payload[pos], &chunk[CMD_CHUNK_HEADER_LEN], n);
+        rx_mask |= (1 << idx);
+        if (rx_mask != (1 << cnt) - 1) return false;
+
+        Reset();
+        if (crc16_calculate(payload, len) != crc) return false;
+        memset(&payload[len], 0, payload_len - len);
+        return true;
+    }
+
+  private:
+    uint8_t tx_idx;
+    uint8_t rx_cnt;
+    uint8_t rx_len;
+    uint16_t rx_crc;
+    uint16_t rx_mask;
+};
+
+CmdFrameChunker cmd_chunker;
+
+
+bool frame_is_slim(void)
+{
+    return (Config.frame_len < FRAME_TX_RX_LEN);
+}
+
+
+void _pack_txcmdframe(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc, uint8_t* payload, uint8_t payload_len)
+{
+uint8_t chunk[FRAME_TX_PAYLOAD_LEN];
+
+    if (frame_is_slim()) {
+        payload_len = cmd_chunker.Pack(chunk, Config.frame_tx_payload_len, payload, payload_len);
+        payload = chunk;
+    }
+
+    _pack_txframe_w_type(frame, FRAME_TYPE_TX_RX_CMD, frame_stats, rc, payload, payload_len);
+}
+
+
+void _pack_rxcmdframe(tRxFrame* frame, tFrameStats* frame_stats, uint8_t* payload, uint8_t payload_len)
+{
+uint8_t chunk[FRAME_RX_PAYLOAD_LEN];
+
+    if (frame_is_slim()) {
+        payload_len = cmd_chunker.Pack(chunk, Config.frame_rx_payload_len, payload, payload_len);
+        payload = chunk;
+    }
+
+    _pack_rxframe_w_type(frame, FRAME_TYPE_TX_RX_CMD, frame_stats, payload, payload_len);
+}
+
+
+// returns true if the cmd frame is complete, with slim frames the chunks are collected into the frame payload
+bool txcmdframe_complete(tTxFrame* frame)
+{
+static uint8_t payload[FRAME_TX_PAYLOAD_LEN];
+
+    if (!frame_is_slim()) return true;
+
+    if (!cmd_chunker.Unpack(payload, FRAME_TX_PAYLOAD_LEN, frame->payload, Config.frame_tx_payload_len)) return false;
+    memcpy(frame->payload, payload, FRAME_TX_PAYLOAD_LEN);
+    return true;
+}
+
+
+bool rxcmdframe_complete(tRxFrame* frame)
+{
+static uint8_t payload[FRAME_RX_PAYLOAD_LEN];
+
+    if (!frame_is_slim()) return true;
+
+    if (!cmd_chunker.Unpack(payload, FRAME_RX_PAYLOAD_LEN, frame->payload, Config.frame_rx_payload_len)) return false;
+    memcpy(frame->payload, payload, FRAME_RX_PAYLOAD_LEN);
+    return true;
+}
+
+
 
 //-------------------------------------------------------
 // Tx/Rx Cmd Frames
@@ -278,7 +595,7 @@ uint8_t payload[1];
 
     payload[0] = cmd;
 
-    _pack_txframe_w_type(frame, FRAME_TYPE_TX_RX_CMD, frame_stats, rc, payload, 1);
+    _pack_txcmdframe(frame, frame_stats, rc, payload, 1);
 }
 
 
@@ -312,6 +629,22 @@ tRxCmdFrameRxSetupData* rx_setupdata = (tRxCmdFrameRxSetupData*)frame->payload;
 }
 
 
+// Tx: handle FRAME_CMD_RX_POWER from Rx
+void unpack_rxcmdframe_rxpower(tRxFrame* frame)
+{
+tRxCmdFrameRxPower* rx_power = (tRxCmdFrameRxPower*)frame->payload;
+
+    SetupMetaData.rx_actual_power_dbm = rx_power->actual_power_dbm;
+}
+
+
+// Tx: handle FRAME_CMD_RX_RC_LATENCY from Rx
+void unpack_rxcmdframe_rclatency(tRxFrame* frame, tRxCmdFrameRcLatency* rc_latency)
+{
+    memcpy(rc_latency, frame->payload, sizeof(tRxCmdFrameRcLatency));
+}
+
+
 // Tx: send new receiver parameters with FRAME_CMD_SET_RX_PARAMS to Rx
 // we take the values from Tx' Setup.Rx structure
 void pack_txcmdframe_setrxparams(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc)
@@ -327,7 +660,35 @@ tTxCmdFrameRxParams rx_params = {};
 
     cmdframerxparameters_rxparams_from_rxsetup(&(rx_params.RxParams));
 
-    _pack_txframe_w_type(frame, FRAME_TYPE_TX_RX_CMD, frame_stats, rc, (uint8_t*)&rx_params, sizeof(rx_params));
+    // with FEC the last bytes are taken by the parity, they are spare
+    _pack_txcmdframe(frame, frame_stats, rc, (uint8_t*)&rx_params, sizeof(rx_params) - FRAME_FEC_LEN);
+}
+
+
+// Tx: send FRAME_CMD_FHSS_SWAP to Rx
+void pack_txcmdframe_fhssswap(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc, uint8_t fhss_i, uint8_t ch)
+{
+tCmdFrameFhssSwap fhss_swap;
+
+    fhss_swap.cmd = FRAME_CMD_FHSS_SWAP;
+    fhss_swap.fhss_i = fhss_i;
+    fhss_swap.ch = ch;
+
+    _pack_txcmdframe(frame, frame_stats, rc, (uint8_t*)&fhss_swap, sizeof(fhss_swap));
+}
+
+
+// Tx: send FRAME_CMD_MODE_SWITCH to Rx
+void pack_txcmdframe_modeswitch(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc, uint8_t mode, uint8_t cnt, bool confirmed)
+{
+tCmdFrameModeSwitch mode_switch;
+
+    mode_switch.cmd = FRAME_CMD_MODE_SWITCH;
+    mode_switch.mode = mode;
+    mode_switch.cnt = cnt;
+    mode_switch.confirmed = (confirmed) ? 1 : 0;
+
+    _pack_txcmdframe(frame, frame_stats, rc, (uint8_t*)&mode_switch, sizeof(mode_switch));
 }
 
 #endif
@@ -340,7 +701,7 @@ uint8_t payload[1];
 
     payload[0] = cmd;
 
-    _pack_rxframe_w_type(frame, FRAME_TYPE_TX_RX_CMD, frame_stats, payload, 1);
+    _pack_rxcmdframe(frame, frame_stats, payload, 1);
 }
 
 
@@ -382,7 +743,57 @@ tRxCmdFrameRxSetupData rx_setupdata = {};
     rx_setupdata.OutMode_allowed_mask = SetupMetaData.Rx_OutMode_allowed_mask;
     rx_setupdata.Buzzer_allowed_mask = SetupMetaData.Rx_Buzzer_allowed_mask;
 
-    _pack_rxframe_w_type(frame, FRAME_TYPE_TX_RX_CMD, frame_stats, (uint8_t*)&rx_setupdata, sizeof(rx_setupdata));
+    // with FEC the last bytes are taken by the parity, they are spare
+    _pack_rxcmdframe(frame, frame_stats, (uint8_t*)&rx_setupdata, sizeof(rx_setupdata) - FRAME_FEC_LEN);
+}
+
+
+// Rx: send FRAME_CMD_FHSS_SWAP_ACK to Tx
+void pack_rxcmdframe_fhssswapack(tRxFrame* frame, tFrameStats* frame_stats, uint8_t fhss_i, uint8_t ch)
+{
+tCmdFrameFhssSwap fhss_swap;
+
+    fhss_swap.cmd = FRAME_CMD_FHSS_SWAP_ACK;
+    fhss_swap.fhss_i = fhss_i;
+    fhss_swap.ch = ch;
+
+    _pack_rxcmdframe(frame, frame_stats, (uint8_t*)&fhss_swap, sizeof(fhss_swap));
+}
+
+
+// Rx: send FRAME_CMD_MODE_SWITCH_ACK to Tx
+void pack_rxcmdframe_modeswitchack(tRxFrame* frame, tFrameStats* frame_stats, uint8_t mode, uint8_t cnt)
+{
+tCmdFrameModeSwitch mode_switch;
+
+    mode_switch.cmd = FRAME_CMD_MODE_SWITCH_ACK;
+    mode_switch.mode = mode;
+    mode_switch.cnt = cnt;
+    mode_switch.confirmed = 0;
+
+    _pack_rxcmdframe(frame, frame_stats, (uint8_t*)&mode_switch, sizeof(mode_switch));
+}
+
+
+// Rx: send FRAME_CMD_RX_POWER to Tx
+void pack_rxcmdframe_rxpower(tRxFrame* frame, tFrameStats* frame_stats)
+{
+tRxCmdFrameRxPower rx_power;
+
+    rx_power.cmd = FRAME_CMD_RX_POWER;
+    rx_power.actual_power_dbm = sx.RfPower_dbm();
+
+    _pack_rxcmdframe(frame, frame_stats, (uint8_t*)&rx_power, sizeof(rx_power));
+}
+
+
+// Rx: send FRAME_CMD_RX_RC_LATENCY to Tx
+void pack_rxcmdframe_rclatency(tRxFrame* frame, tFrameStats* frame_stats, tRxCmdFrameRcLatency* rc_latency)
+{
+    rc_latency->cmd = FRAME_CMD_RX_RC_LATENCY;
+    rc_latency->spare = 0;
+
+    _pack_rxcmdframe(frame, frame_stats, (uint8_t*)rc_latency, sizeof(tRxCmdFrameRcLatency));
 }
 
 
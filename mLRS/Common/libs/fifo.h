@@ -12,11 +12,25 @@
 
 
 #include <inttypes.h>
+#include <string.h>
+
+
+// single producer, single consumer fifo, lock-free
+// one side may run in an ISR and the other in the main loop
+// - writepos is only changed by the producer, readpos only by the consumer
+// - the data is stored/fetched before the position is advanced, the barrier ensures the compiler
+//   keeps this order (the MCUs are single core, so a compiler barrier is sufficient)
+// - the fifo can hold FIFO_SIZE - 1 elements
+
+#define FIFO_BARRIER()  __asm__ volatile ("" ::: "memory")
+
 
 template <class T, uint16_t FIFO_SIZE>
 class FifoBase
 {
   public:
+    static_assert((FIFO_SIZE >= 2) && !(FIFO_SIZE & (FIFO_SIZE - 1)), "FIFO_SIZE must be power of 2");
+
     FifoBase() // constructor
     {
         Init();
@@ -25,30 +39,44 @@ class FifoBase
     void Init(void)
     {
         writepos = readpos = 0;
-        SIZEMASK = FIFO_SIZE - 1;
     }
 
+    //-- write side
+
     bool Put(T c)
     {
-        uint16_t next = (writepos + 1) & (SIZEMASK);
+        uint16_t wpos = writepos;
+        uint16_t next = (wpos + 1) & SIZEMASK;
         if (next != readpos) { // fifo not full
-            buf[writepos] = c;
+            buf[wpos] = c;
+            FIFO_BARRIER();
             writepos = next;
             return true;
         }
         return false;
     }
 
-    void PutBuf(void* buf, uint16_t len)
+    // puts as many as fit, returns the number of elements put
+    uint16_t PutBuf(void* _buf, uint16_t len)
     {
-        for (uint16_t i = 0; i < len; i++) Put(((T*)buf)[i]);
+        uint16_t free = Free();
+        if (len > free) len = free;
+        if (!len) return 0;
+
+        uint16_t wpos = writepos;
+        uint16_t len1 = FIFO_SIZE - wpos; // to the end of buf
+        if (len1 > len) len1 = len;
+        memcpy(&buf[wpos], _buf, len1 * sizeof(T));
+        if (len > len1) memcpy(&buf[0], (T*)_buf + len1, (len - len1) * sizeof(T));
+
+        FIFO_BARRIER();
+        writepos = (wpos + len) & SIZEMASK;
+        return len;
     }
 
-    uint16_t Available(void)
+    uint16_t Free(void)
     {
-        int16_t d = (int16_t)writepos - (int16_t)readpos;
-        if (d < 0) return d + (SIZEMASK + 1);
-        return d;
+        return SIZEMASK - Available();
     }
 
     bool HasSpace(uint16_t space)
@@ -56,25 +84,55 @@ class FifoBase
         return (Available() < (FIFO_SIZE - space));
     }
 
+    //-- read side
+
+    uint16_t Available(void)
+    {
+        return (writepos - readpos) & SIZEMASK;
+    }
+
     T Get(void)
     {
-        if (writepos != readpos) { // fifo not empty
-            T c = buf[readpos];
-            readpos = (readpos + 1) & (SIZEMASK);
+        uint16_t rpos = readpos;
+        if (writepos != rpos) { // fifo not empty
+            FIFO_BARRIER();
+            T c = buf[rpos];
+            FIFO_BARRIER();
+            readpos = (rpos + 1) & SIZEMASK;
             return c;
         }
         return 0;
     }
 
+    // gets up to len elements, returns the number of elements got
+    uint16_t GetBuf(void* _buf, uint16_t len)
+    {
+        uint16_t available = Available();
+        if (len > available) len = available;
+        if (!len) return 0;
+
+        FIFO_BARRIER();
+        uint16_t rpos = readpos;
+        uint16_t len1 = FIFO_SIZE - rpos; // to the end of buf
+        if (len1 > len) len1 = len;
+        memcpy(_buf, &buf[rpos], len1 * sizeof(T));
+        if (len > len1) memcpy((T*)_buf + len1, &buf[0], (len - len1) * sizeof(T));
+
+        FIFO_BARRIER();
+        readpos = (rpos + len) & SIZEMASK;
+        return len;
+    }
+
     void Flush(void)
     {
-        writepos = readpos = 0;
+        readpos = writepos;
     }
 
   private:
-    uint16_t writepos; // pos at which the next byte will be stored
-    uint16_t readpos; // pos at which the oldest byte is fetched
-    uint16_t SIZEMASK;
+    static const uint16_t SIZEMASK = FIFO_SIZE - 1;
+
+    volatile uint16_t writepos; // pos at which the next element will be stored
+    volatile uint16_t readpos; // pos at which the oldest element is fetched
     T buf[FIFO_SIZE];
 };
 
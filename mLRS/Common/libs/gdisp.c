@@ -207,6 +207,17 @@ HAL_StatusTypeDef ssd1306_put_noblock(uint8_t* buf, uint16_t len)
 }
 
 
+// sets the page window and sends the pages in one transfer, buf must point to page_start
+// in horizontal addressing mode the display wraps to the next page within the window
+HAL_StatusTypeDef ssd1306_put_pages_noblock(uint8_t* buf, uint8_t page_start, uint8_t page_end)
+{
+    uint8_t cmd[6] = {0x21, 0, 127, 0x22, page_start, page_end};
+    HAL_StatusTypeDef res = i2c_put_blocked(SSD1306_CMD, cmd, 6);
+    if (res != HAL_OK) return res; // the window is not set, so don't send the data
+    return i2c_put(SSD1306_DATA, buf, (uint16_t)(page_end - page_start + 1) * GDISPLAY_COLUMNS);
+}
+
+
 //-------------------------------------------------------
 // Graphical display API
 //-------------------------------------------------------
@@ -248,6 +259,17 @@ HAL_StatusTypeDef gdisp_hal_put(uint8_t* buf, uint16_t len)
 }
 
 
+HAL_StatusTypeDef gdisp_hal_put_pages(uint8_t page_start, uint8_t page_end)
+{
+    switch (gdisp.type) {
+        case GDISPLAY_TYPE_SSD1306:
+            return ssd1306_put_pages_noblock(&(gdisp.buf[page_start * GDISPLAY_COLUMNS]), page_start, page_end);
+        case GDISPLAY_TYPE_SH1106: return HAL_OK;
+    }
+    return HAL_OK;
+}
+
+
 void gdisp_hal_contraststart(void)
 {
     switch (gdisp.type) {
@@ -281,28 +303,79 @@ void gdisp_hal_contrast(uint8_t c)
 // can be called by the user
 //-------------------------------------------------------
 
+// FNV-1a, cheap and good enough to detect a changed page
+static uint32_t gdisp_page_hash_(uint8_t page)
+{
+    uint8_t* p = &(gdisp.buf[page * GDISPLAY_COLUMNS]);
+    uint32_t hash = 2166136261UL;
+
+    for (uint16_t i = 0; i < GDISPLAY_COLUMNS; i++) {
+        hash ^= p[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+
+static inline uint8_t gdisp_page_changed_(uint8_t page, uint32_t hash)
+{
+    if (!(gdisp.sent_valid & (1 << page))) return 1;
+    return (hash != gdisp.sent_hash[page]) ? 1 : 0;
+}
+
+
+static inline void gdisp_u_reset_(void)
+{
+    gdisp.minx = GDISPLAY_COLUMNS;
+    gdisp.miny = GDISPLAY_ROWS;
+    gdisp.maxx = gdisp.maxy = 0;
+    gdisp.needsupdate = 0;
+}
+
+
 void gdisp_update(void)
 {
     // this must not be called too frequently, any I2C transfers must have been finsihed
 
-    // for the moment we simply copy the complete buf to the display
-    // we should be smarter and use the rectangle
+    // we send only the pages within the rectangle, which have changed since they were last send
+    // the pages from the first to the last changed page are send in one transfer, so that it can
+    // be done by DMA
+    // the display pages are usually cleared and redrawn, so we compare with a hash of what was last
+    // send to find the pages which really changed, a copy of the pages would cost GDISPLAY_BUFSIZE bytes of RAM
 
     if (!gdisp.needsupdate) return;
 
-    //gdisp_hal_cmdhome(); // does not appear to make a difference
+    int16_t miny = (gdisp.miny < 0) ? 0 : gdisp.miny;
+    int16_t maxy = (gdisp.maxy >= GDISPLAY_ROWS) ? GDISPLAY_ROWS - 1 : gdisp.maxy;
+    uint8_t page_start = GDISPLAY_PAGES;
+    uint8_t page_end = 0;
+    uint32_t hash[GDISPLAY_PAGES];
+
+    for (uint8_t page = miny / GDISPLAY_ROWS_PER_PAGE; page <= maxy / GDISPLAY_ROWS_PER_PAGE; page++) {
+        hash[page] = gdisp_page_hash_(page);
+        if (!gdisp_page_changed_(page, hash[page])) continue;
+        if (page < page_start) page_start = page;
+        page_end = page;
+    }
 
-    HAL_StatusTypeDef res = gdisp_hal_put(gdisp.buf, GDISPLAY_BUFSIZE);
-//    HAL_StatusTypeDef res = ssd1306_put(gdisp.buf, GDISPLAY_BUFSIZE);
-//    HAL_StatusTypeDef res = ssd1306_put_noblock(gdisp.buf, GDISPLAY_BUFSIZE);
+    if (page_start > page_end) { // nothing changed
+        gdisp_u_reset_();
+        return;
+    }
+
+    HAL_StatusTypeDef res = gdisp_hal_put_pages(page_start, page_end);
+//    HAL_StatusTypeDef res = gdisp_hal_put(gdisp.buf, GDISPLAY_BUFSIZE);
 //    while (i2c_device_ready() == HAL_BUSY) {};
 
     if (res != HAL_OK) return; // retry, needs update is not reset, so it will tried the next time again
 
-    gdisp.minx = gdisp.width;
-    gdisp.miny = gdisp.height;
-    gdisp.maxx = gdisp.maxy = 0;
-    gdisp.needsupdate = 0;
+    // if buf is changed while the transfer is running, the page's hash differs and it is send again
+    for (uint8_t page = page_start; page <= page_end; page++) {
+        gdisp.sent_hash[page] = hash[page];
+        gdisp.sent_valid |= (1 << page);
+    }
+
+    gdisp_u_reset_();
 }
 
 
@@ -326,10 +399,8 @@ void gdisp_setrotation(uint16_t rotation)
     }
 
     // clear
-    gdisp.minx = gdisp.width;
-    gdisp.miny = gdisp.height;
-    gdisp.maxx = gdisp.maxy = 0;
-    gdisp.needsupdate = 0;
+    gdisp_u_reset_();
+    gdisp.sent_valid = 0; // forces all pages to be send with the next update
     memset(gdisp.buf, 0, GDISPLAY_BUFSIZE);
 }
 
@@ -369,6 +440,81 @@ void gdisp_setpixel_(uint16_t x, uint16_t y, uint16_t color)
 }
 
 
+// the buffer is organized in pages of 8 rows, each byte is a column of 8 pixels with the lsb at the top
+// so we can write 8 vertical pixels at once, as one byte if aligned to a page, else as two shifted bytes
+
+// writes 8 vertical pixels starting at x,y, only the pixels in mask are changed
+// x,y are buffer coordinates, pixels outside of the buffer are clipped
+static void gdisp_setcolumn_(int16_t x, int16_t y, uint8_t bits, uint8_t mask)
+{
+    if ((x < 0) || (x >= GDISPLAY_COLUMNS)) return;
+    if ((y <= -8) || (y >= GDISPLAY_ROWS)) return;
+
+    int16_t page = (y + 8) / 8 - 1; // rounds down also for y < 0
+    uint8_t shift = y - page * 8;
+    uint8_t* p;
+    uint8_t m;
+
+    gdisp_u_(x, x, y, y + 7);
+
+    if (page >= 0) {
+        p = &(gdisp.buf[x + page * GDISPLAY_COLUMNS]);
+        m = mask << shift;
+        *p = (*p & ~m) | ((bits << shift) & m);
+    }
+    if (shift && (page + 1 < GDISPLAY_PAGES)) {
+        p = &(gdisp.buf[x + (page + 1) * GDISPLAY_COLUMNS]);
+        m = mask >> (8 - shift);
+        *p = (*p & ~m) | ((bits >> (8 - shift)) & m);
+    }
+}
+
+
+// fills the rectangle x0..x1, y0..y1 given in buffer coordinates, pixels outside of the buffer are clipped
+static void gdisp_fillrect_buf_(int16_t x0, int16_t x1, int16_t y0, int16_t y1, uint16_t color)
+{
+    if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; } // swap
+    if (y0 > y1) { int16_t t = y0; y0 = y1; y1 = t; } // swap
+    if (x0 < 0) x0 = 0;
+    if (x1 >= GDISPLAY_COLUMNS) x1 = GDISPLAY_COLUMNS - 1;
+    if (y0 < 0) y0 = 0;
+    if (y1 >= GDISPLAY_ROWS) y1 = GDISPLAY_ROWS - 1;
+    if ((x0 > x1) || (y0 > y1)) return;
+
+    gdisp_u_(x0, x1, y0, y1);
+
+    for (int16_t page = y0 / 8; page <= y1 / 8; page++) {
+        uint8_t mask = 0xFF;
+        if (page == y0 / 8) mask &= (uint8_t)(0xFF << (y0 & 7));
+        if (page == y1 / 8) mask &= (uint8_t)(0xFF >> (7 - (y1 & 7)));
+
+        uint8_t* p = &(gdisp.buf[page * GDISPLAY_COLUMNS]);
+        if (color & 0x01) {
+            for (int16_t x = x0; x <= x1; x++) p[x] |= mask;
+        } else {
+            for (int16_t x = x0; x <= x1; x++) p[x] &= ~mask;
+        }
+    }
+}
+
+
+// fills the rectangle x0..x1, y0..y1 given in display coordinates
+// a rotation maps a rectangle to a rectangle, so this works for all rotations
+static void gdisp_fillrect_(int16_t x0, int16_t x1, int16_t y0, int16_t y1, uint16_t color)
+{
+    switch (gdisp.rotation) {
+        case GDISPLAY_ROTATION_90:
+            gdisp_fillrect_buf_((GDISPLAY_COLUMNS-1)-y1, (GDISPLAY_COLUMNS-1)-y0, x0, x1, color); return;
+        case GDISPLAY_ROTATION_180:
+            gdisp_fillrect_buf_((GDISPLAY_COLUMNS-1)-x1, (GDISPLAY_COLUMNS-1)-x0, (GDISPLAY_ROWS-1)-y1, (GDISPLAY_ROWS-1)-y0, color); return;
+        case GDISPLAY_ROTATION_270:
+            gdisp_fillrect_buf_(y0, y1, (GDISPLAY_ROWS-1)-x1, (GDISPLAY_ROWS-1)-x0, color); return;
+        default:
+            gdisp_fillrect_buf_(x0, x1, y0, y1, color);
+    }
+}
+
+
 //-------------------------------------------------------
 // High-level API
 // Draw primitives
@@ -376,7 +522,7 @@ void gdisp_setpixel_(uint16_t x, uint16_t y, uint16_t color)
 
 void gdisp_clear(void)
 {
-    gdisp_u_(0, 0, gdisp.width - 1, gdisp.height - 1);
+    gdisp_u_(0, GDISPLAY_COLUMNS - 1, 0, GDISPLAY_ROWS - 1); // these are buffer coordinates
     memset(gdisp.buf, 0, GDISPLAY_BUFSIZE);
 }
 
@@ -431,9 +577,10 @@ void gdisp_writeline(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t co
 void gdisp_drawline_H(int16_t x0, int16_t y0, int16_t w, uint16_t color)
 {
     if (w < 0) {
-        for (int16_t i = 0; i < -w; i++) gdisp_drawpixel(x0 - i, y0, color);
-    } else {
-        for (int16_t i = 0; i < w; i++) gdisp_drawpixel(x0 + i, y0, color);
+        gdisp_fillrect_(x0 + w + 1, x0, y0, y0, color);
+    } else
+    if (w > 0) {
+        gdisp_fillrect_(x0, x0 + w - 1, y0, y0, color);
     }
 }
 
@@ -441,9 +588,10 @@ void gdisp_drawline_H(int16_t x0, int16_t y0, int16_t w, uint16_t color)
 void gdisp_drawline_V(int16_t x0, int16_t y0, int16_t h, uint16_t color)
 {
     if (h < 0) {
-        for (int16_t i = 0; i < -h; i++) gdisp_drawpixel(x0, y0 - i, color);
-    } else {
-        for (int16_t i = 0; i < h; i++) gdisp_drawpixel(x0, y0 + i, color);
+        gdisp_fillrect_(x0, x0, y0 + h + 1, y0, color);
+    } else
+    if (h > 0) {
+        gdisp_fillrect_(x0, x0, y0, y0 + h - 1, color);
     }
 }
 
@@ -482,11 +630,10 @@ void gdisp_drawrect(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t col
 
 void gdisp_fillrect_WH(int16_t x0, int16_t y0, int16_t w, int16_t h, uint16_t color)
 {
-    if (h < 0) {
-        for (int16_t y = y0; y > y0 + h; y--) gdisp_drawline_H(x0, y, w, color);
-    } else {
-        for (int16_t y = y0; y < y0 + h; y++) gdisp_drawline_H(x0, y, w, color);
-    }
+    if (!w || !h) return;
+    int16_t x1 = (w < 0) ? x0 + w + 1 : x0 + w - 1;
+    int16_t y1 = (h < 0) ? y0 + h + 1 : y0 + h - 1;
+    gdisp_fillrect_(x0, x1, y0, y1, color);
 }
 
 
@@ -531,6 +678,15 @@ void gdisp_w(char c)
 
     gdisp.curX += 6;
 
+    if (gdisp.rotation == GDISPLAY_ROTATION_NORMAL) { // fast path, font bytes are columns like the buffer
+        for (uint16_t i = 0; i < 6; i++) {
+            uint8_t b = font6x8[c * 6 + i];
+            if (gdisp.inverted) b = ~b;
+            gdisp_setcolumn_(x + i, y, b, 0xFF);
+        }
+        return;
+    }
+
     for (uint16_t i = 0; i < 6; i++) {
         uint8_t b = font6x8[c * 6 + i];
         if (gdisp.inverted) b = ~b;
@@ -574,6 +730,26 @@ void gdisp_wf(char c)
     uint16_t bits = 0;
     uint16_t bo = glyph->bitmapOffset;
     uint16_t col = (gdisp.inverted) ? 0 : 1;
+
+    if ((gdisp.rotation == GDISPLAY_ROTATION_NORMAL) && (w <= GDISPLAY_GLYPH_WIDTH_MAX)) { // fast path
+        // the glyph bitmap is row by row, so we collect bands of 8 rows into columns and write these as bytes
+        uint8_t column[GDISPLAY_GLYPH_WIDTH_MAX];
+        for (uint16_t yy0 = 0; yy0 < h; yy0 += 8) {
+            memset(column, 0, w);
+            for (uint16_t yy = yy0; (yy < yy0 + 8) && (yy < h); yy++) {
+                for (uint16_t xx = 0; xx < w; xx++) {
+                    if (!(bit++ & 7)) bits = bitmap[bo++];
+                    if (bits & 0x80) column[xx] |= (1 << (yy - yy0));
+                    bits <<= 1;
+                }
+            }
+            for (uint16_t xx = 0; xx < w; xx++) {
+                if (column[xx]) gdisp_setcolumn_(x + xo + xx, y + yo + yy0, (col) ? 0xFF : 0x00, column[xx]);
+            }
+        }
+        return;
+    }
+
     for (uint16_t yy = 0; yy < h; yy++) {
         for (uint16_t xx = 0; xx < w; xx++) {
             if (!(bit++ & 7)) bits = bitmap[bo++];
@@ -645,6 +821,7 @@ void gdisp_init(uint16_t type)
 
     //gdisp.minx = gdisp.miny = gdisp.maxx = gdisp.maxy = 0;
     //  gdisp.needsupdate = 0;
+    gdisp.sent_valid = 0;
     gdisp.needsupdate = 1; // we fake this here
     gdisp_clear();
     gdisp_update();
@@ -51,6 +51,7 @@ void ssd1306_contraststart(void);
 void ssd1306_contrastend(void);
 void ssd1306_contrast(uint8_t c);
 HAL_StatusTypeDef ssd1306_put_noblock(uint8_t* buf, uint16_t len);
+HAL_StatusTypeDef ssd1306_put_pages_noblock(uint8_t* buf, uint8_t page_start, uint8_t page_end);
 
 
 //-------------------------------------------------------
@@ -65,6 +66,8 @@ HAL_StatusTypeDef ssd1306_put_noblock(uint8_t* buf, uint16_t len);
 #define GDISPLAY_ROWS_PER_PAGE    (GDISPLAY_ROWS / GDISPLAY_PAGES)
 #define GDISPLAY_BUFSIZE          (GDISPLAY_COLUMNS * GDISPLAY_PAGES)
 
+#define GDISPLAY_GLYPH_WIDTH_MAX  32 // glyphs up to this width are drawn with the fast path
+
 
 typedef enum {
     GDISPLAY_TYPE_SSD1306 = 0,
@@ -104,6 +107,10 @@ typedef struct {
     int16_t miny;
     int16_t maxy;
 
+    // to catch the pages which have changed since they were last send to the display
+    uint8_t sent_valid; // bit mask, a page with invalid hash is always send
+    uint32_t sent_hash[GDISPLAY_PAGES]; // hash of each page as it was last send to the display
+
     uint8_t buf[GDISPLAY_BUFSIZE] ALIGNED8_ATTR;
 } tGDisplay;
 
@@ -115,6 +122,7 @@ typedef struct {
 void gdisp_hal_init(uint16_t type);
 void gdisp_hal_cmdhome(void);
 HAL_StatusTypeDef gdisp_hal_put(uint8_t* buf, uint16_t len);
+HAL_StatusTypeDef gdisp_hal_put_pages(uint8_t page_start, uint8_t page_end);
 void gdisp_hal_contraststart(void);
 void gdisp_hal_contrastend(void);
 void gdisp_hal_contrast(uint8_t c);
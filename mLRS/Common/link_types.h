@@ -63,10 +63,16 @@ typedef enum {
     LINK_TASK_TX_SET_RX_PARAMS,
     LINK_TASK_TX_STORE_RX_PARAMS,
     LINK_TASK_TX_GET_RX_SETUPDATA_WRELOAD,
+    LINK_TASK_TX_FHSS_SWAP,
+    LINK_TASK_TX_MODE_SWITCH,
 #endif
 
 #ifdef DEVICE_IS_RECEIVER
     LINK_TASK_RX_SEND_RX_SETUPDATA,
+    LINK_TASK_RX_SEND_FHSS_SWAP_ACK,
+    LINK_TASK_RX_SEND_RX_POWER,
+    LINK_TASK_RX_SEND_MODE_SWITCH_ACK,
+    LINK_TASK_RX_SEND_RC_LATENCY,
 #endif
 } LINK_TASK_ENUM;
 
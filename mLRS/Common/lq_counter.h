@@ -86,6 +86,12 @@ class StatsBytes : public StatsCount
 //-------------------------------------------------------
 // that's another way to get stats
 
+// the count of set bits in the window is kept running, so that Set() and Next() are O(1)
+// periods up to LQ_COUNTER_PERIOD_MAX are supported
+
+#define LQ_COUNTER_PERIOD_MAX  255
+
+
 class LqCounterBase
 {
   public:
@@ -97,29 +103,51 @@ class LqCounterBase
 
     void SetPeriod(uint8_t new_period)
     {
+        if (new_period < 1) new_period = 1;
         period = new_period;
-        periodbit = (uint64_t)1 << (period - 1);
+    }
+
+    // changes the period while running, the window is refilled such that the LQ is kept
+    void ChangePeriod(uint8_t new_period)
+    {
+        uint8_t LQ = GetNormalized();
+        SetPeriod(new_period);
+        memset(shiftreg, 0, sizeof(shiftreg));
+        count = ((uint16_t)LQ * period + 50) / 100;
+        for (uint8_t i = 0; i < count; i++) shiftreg[i >> 5] |= (uint32_t)1 << (i & 0x1F);
+        curidx = period - 1;
+        last_LQraw = count;
     }
 
     void Reset(void)
     {
-        shiftreg = 0xFFFFFFFFFFFFFFFF; // this makes it that it starts with 100%
-        curbit = periodbit; // so that calling Next() makes it to start at bit 1
+        memset(shiftreg, 0xFF, sizeof(shiftreg)); // this makes it that it starts with 100%
+        curidx = period - 1; // so that calling Next() makes it to start at bit 0
+        count = period;
         last_LQraw = period;
     }
 
     void Set(void)
     {
-        shiftreg |= curbit;
+        uint32_t mask = (uint32_t)1 << (curidx & 0x1F);
+        if (!(shiftreg[curidx >> 5] & mask)) {
+            shiftreg[curidx >> 5] |= mask;
+            count++;
+        }
     }
 
     void Next(void)
     {
-        last_LQraw = calc_raw(); // buffer it, required since Next() and Set() do not coincide
+        last_LQraw = count; // buffer it, required since Next() and Set() do not coincide
 
-        curbit <<= 1;
-        if (curbit > periodbit) curbit = 1;
-        shiftreg &=~ curbit;
+        curidx++;
+        if (curidx >= period) curidx = 0;
+
+        uint32_t mask = (uint32_t)1 << (curidx & 0x1F);
+        if (shiftreg[curidx >> 5] & mask) {
+            shiftreg[curidx >> 5] &=~ mask;
+            count--;
+        }
     }
 
     uint8_t GetRaw(void)
@@ -129,26 +157,15 @@ class LqCounterBase
 
     uint8_t GetNormalized(void)
     {
-        return (last_LQraw * 100 + period/2) / period;
+        return ((uint16_t)last_LQraw * 100 + period/2) / period;
     }
 
   private:
     uint8_t period;
-    uint64_t periodbit;
-    uint64_t shiftreg;
-    uint64_t curbit;
+    uint32_t shiftreg[(LQ_COUNTER_PERIOD_MAX + 31) / 32];
+    uint8_t curidx;
+    uint8_t count; // number of set bits in the window
     uint8_t last_LQraw;
-
-    uint8_t calc_raw(void)
-    {
-        uint16_t LQraw = 0;
-        uint64_t bit = 1;
-        while (bit <= periodbit) {
-            if (shiftreg & bit) LQraw++;
-            bit <<= 1;
-        }
-        return LQraw;
-    }
 };
 
 
@@ -130,4 +130,268 @@ class ComponentList
 };
 
 
+//-------------------------------------------------------
+// Header Compression
+//-------------------------------------------------------
+// MAVLink v2 frames are send over the link in a compressed format, and are rebuild on the other side
+//   0xFC, len, seq, sysid, compid, msgid (1 or 2 bytes), payload, crc low byte
+// - incompat and compat flags must be zero, and the msgid must be < 32768
+// - msgid is encoded in 7-bit chunks, bit 7 of the first byte indicates a second byte
+// - the crc is recalculated on the other side, so only frames with valid crc are compressed, the low byte
+//   is kept to verify the rebuild frame, a frame which doesn't match is dropped
+// this saves 4 or 5 bytes per message
+// all other bytes are passed through as is, except of stray 0xFC bytes, which are dropped
+// the framing must be tracked on both sides in the same way, so the link must not loose bytes, which is
+// ensured by ARQ, should the framing get out of sync nevertheless, the crc byte catches it
+
+#if defined USE_MAVLINK_COMPRESSION && !defined USE_MAVLINK_PACKING
+  #error USE_MAVLINK_COMPRESSION requires USE_MAVLINK_PACKING !
+#endif
+#if defined USE_MAVLINK_COMPRESSION && !defined USE_ARQ
+  #error USE_MAVLINK_COMPRESSION requires USE_ARQ !
+#endif
+
+#define MAVLINK_COMPRESSED_MAGIC    0xFC
+#define MAVLINK_PACKER_BUF_SIZE     280 // max mavlink frame size
+
+
+// compresses the complete frame in buf in place, returns the new length, or len if it can't be compressed
+uint16_t mavlink_compress_frame(uint8_t* buf, uint16_t len)
+{
+    if (buf[0] != 0xFD) return len; // not v2
+    if (buf[2] || buf[3]) return len; // incompat or compat flags set, e.g. signed
+    if (buf[9] || (buf[8] & 0x80)) return len; // msgid too large
+
+    uint8_t payload_len = buf[1];
+    if (len != 12 + payload_len) return len; // must not happen
+
+    uint16_t msgid = (uint16_t)buf[7] + ((uint16_t)buf[8] << 8);
+    const fmav_message_entry_t* entry = fmav_get_message_entry(msgid);
+    if (!entry) return len; // unknown message, we can't rebuild the crc
+
+    uint16_t crc = fmav_crc_calculate(buf + 1, 9);
+    fmav_crc_accumulate_buf(&crc, buf + 10, payload_len);
+    fmav_crc_accumulate(&crc, entry->crc_extra);
+    if (crc != (uint16_t)buf[10 + payload_len] + ((uint16_t)buf[11 + payload_len] << 8)) return len; // leave it to the parser to reject
+
+    uint8_t crc_low = crc;
+    buf[0] = MAVLINK_COMPRESSED_MAGIC;
+    buf[2] = buf[4]; // seq
+    buf[3] = buf[5]; // sysid
+    buf[4] = buf[6]; // compid
+    uint8_t header_len = 6;
+    if (msgid < 128) {
+        buf[5] = msgid;
+    } else {
+        buf[5] = (msgid & 0x7F) | 0x80;
+        buf[6] = msgid >> 7;
+        header_len = 7;
+    }
+    memmove(buf + header_len, buf + 10, payload_len);
+    buf[header_len + payload_len] = crc_low;
+
+    return header_len + payload_len + 1;
+}
+
+
+// tracks the framing of the bytes received from the link, and rebuilds compressed frames
+class MavlinkUnpacker
+{
+  public:
+    void Init(void)
+    {
+        len = 0;
+        msg_len = 0;
+    }
+
+    // returns the number of bytes in buf which are ready to be parsed
+    uint16_t Put(uint8_t c)
+    {
+        if (len == 0) {
+            if ((c != 0xFD) && (c != 0xFE) && (c != MAVLINK_COMPRESSED_MAGIC)) { // pass on as single byte
+                buf[0] = c;
+                return 1;
+            }
+        }
+
+        buf[len++] = c;
+
+        if ((len == 2) && (buf[0] == 0xFE)) {
+            msg_len = 8 + buf[1];
+        } else
+        if ((len == 3) && (buf[0] == 0xFD)) {
+            msg_len = 12 + buf[1] + ((buf[2] & 0x01) ? 13 : 0);
+        } else
+        if ((len == 6) && (buf[0] == MAVLINK_COMPRESSED_MAGIC)) {
+            msg_len = ((buf[5] & 0x80) ? 7 : 6) + buf[1] + 1; // header + payload + crc low byte
+        }
+
+        if (!msg_len || (len < msg_len)) return 0;
+
+        uint16_t frame_len = (buf[0] == MAVLINK_COMPRESSED_MAGIC) ? rebuild_frame() : len;
+        Init();
+        return frame_len;
+    }
+
+    uint8_t* Buf(void)
+    {
+        return buf;
+    }
+
+  private:
+    uint16_t rebuild_frame(void)
+    {
+        uint8_t payload_len = buf[1];
+        uint8_t seq = buf[2];
+        uint8_t sysid = buf[3];
+        uint8_t compid = buf[4];
+        uint8_t header_len = 6;
+        uint16_t msgid = buf[5] & 0x7F;
+        if (buf[5] & 0x80) {
+            msgid += (uint16_t)buf[6] << 7;
+            header_len = 7;
+        }
+
+        const fmav_message_entry_t* entry = fmav_get_message_entry(msgid);
+        if (!entry) return 0; // must not happen, drop it
+
+        uint8_t crc_low = buf[header_len + payload_len];
+        memmove(buf + 10, buf + header_len, payload_len);
+        buf[0] = 0xFD;
+        buf[2] = 0; // incompat flags
+        buf[3] = 0; // compat flags
+        buf[4] = seq;
+        buf[5] = sysid;
+        buf[6] = compid;
+        buf[7] = msgid;
+        buf[8] = msgid >> 8;
+        buf[9] = 0;
+
+        uint16_t crc = fmav_crc_calculate(buf + 1, 9);
+        fmav_crc_accumulate_buf(&crc, buf + 10, payload_len);
+        fmav_crc_accumulate(&crc, entry->crc_extra);
+        if ((uint8_t)crc != crc_low) return 0; // framing got out of sync, drop it
+        buf[10 + payload_len] = crc;
+        buf[11 + payload_len] = crc >> 8;
+
+        return 12 + payload_len;
+    }
+
+    uint8_t buf[MAVLINK_PACKER_BUF_SIZE];
+    uint16_t len; // number of bytes in buf
+    uint16_t msg_len; // length of the frame in buf, 0 if not yet known
+};
+
+
+//-------------------------------------------------------
+// Packer Class
+//-------------------------------------------------------
+// fills the payload of radio frames with whole MAVLink messages as far as possible
+// - a message is not split across frames if it would fit completely into the next frame
+// - messages which are larger than a frame are fragmented
+// - it only tracks the frame boundaries from the header, the crc is not checked, bytes which
+//   are not the start of a MAVLink frame are passed as single bytes, so the data stream is never changed
+// - with USE_MAVLINK_COMPRESSION complete v2 frames are compressed, and stray 0xFC bytes are dropped
+// - an incomplete message is held back for at most MAVLINK_PACKER_TMO_MS
+
+#define MAVLINK_PACKER_TMO_MS       50
+
+
+class MavlinkPacker
+{
+  public:
+    void Init(void)
+    {
+        Flush();
+    }
+
+    void Flush(void)
+    {
+        len = 0;
+        pos = 0;
+        msg_len = 0;
+    }
+
+    // reads from serial and fills the payload, returns the number of bytes filled in
+    uint8_t GetPayload(tSerialBase* serial, uint8_t* payload, uint8_t payload_max_len)
+    {
+        uint8_t payload_len = 0;
+
+        while (payload_len < payload_max_len) {
+            fill(serial);
+            if (pos >= len) break; // nothing to send
+
+            uint8_t free = payload_max_len - payload_len;
+            uint16_t n = len - pos;
+            bool complete = (msg_len && len >= msg_len);
+
+            if (complete) {
+                if (n > free) {
+                    if (payload_len && (msg_len <= payload_max_len)) break; // fits into next frame, so don't split it
+                    n = free;
+                }
+            } else {
+                // wait for the rest, unless it's larger than a frame anyway, or we waited for too long
+                if ((msg_len <= payload_max_len) && ((millis32() - tstart_ms) < MAVLINK_PACKER_TMO_MS)) break;
+                if (n > free) n = free;
+            }
+
+            memcpy(payload + payload_len, buf + pos, n);
+            payload_len += n;
+            pos += n;
+
+            if (complete && (pos >= msg_len)) Flush();
+        }
+
+        return payload_len;
+    }
+
+    // bytes taken from serial but not yet handed out
+    uint16_t BytesHeld(void)
+    {
+        return len - pos;
+    }
+
+  private:
+    void fill(tSerialBase* serial)
+    {
+        while (!(msg_len && (len >= msg_len)) && serial->available()) {
+            uint8_t c = serial->getc();
+            buf[len++] = c;
+
+            if (len == 1) {
+                tstart_ms = millis32();
+                if ((c != 0xFD) && (c != 0xFE)) {
+#ifdef USE_MAVLINK_COMPRESSION
+                    if (c == MAVLINK_COMPRESSED_MAGIC) { // would be taken as start of a compressed frame, drop it
+                        len = 0;
+                        continue;
+                    }
+#endif
+                    msg_len = 1; // not a v2 or v1 magic, pass it on as single byte
+                }
+            } else
+            if ((len == 2) && (buf[0] == 0xFE)) {
+                msg_len = 8 + c; // v1: header 6 + payload + crc 2
+            } else
+            if ((len == 3) && (buf[0] == 0xFD)) {
+                msg_len = 12 + buf[1] + ((c & 0x01) ? 13 : 0); // v2: header 10 + payload + crc 2 + signature 13 if signed
+            }
+        }
+
+#ifdef USE_MAVLINK_COMPRESSION
+        if (msg_len && (len >= msg_len) && (pos == 0)) { // complete and nothing send yet
+            len = msg_len = mavlink_compress_frame(buf, len);
+        }
+#endif
+    }
+
+    uint8_t buf[MAVLINK_PACKER_BUF_SIZE];
+    uint16_t len; // number of bytes in buf
+    uint16_t pos; // number of bytes in buf which have been send already
+    uint16_t msg_len; // length of the message in buf, 0 if not yet known
+    uint32_t tstart_ms;
+};
+
+
 #endif // FASTMAVLINK_EXTENSION_H
@@ -0,0 +1,99 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// Adaptive Mode
+//********************************************************
+#ifndef MODE_ADAPTIVE_H
+#define MODE_ADAPTIVE_H
+#pragma once
+
+
+#include <inttypes.h>
+
+
+//-------------------------------------------------------
+// Adaptive Mode
+//-------------------------------------------------------
+// the Tx steps the mode between the setup mode and 19 Hz, depending on the link quality
+// - steps to the next slower mode if the LQ falls below MODE_ADAPTIVE_LQ_DOWN
+// - steps to the next faster mode if the LQ and the rssi margin were good for some seconds
+// - never goes faster than the setup mode
+// only the LoRa modes 50 Hz, 31 Hz, 19 Hz take part, these have the same frame length
+// the fhss list of the setup mode is kept
+//
+// the switch is announced by the Tx with FRAME_CMD_MODE_SWITCH, which carries the number of
+// frames until the switch. The Tx repeats it in each frame with the count going down, and the Rx
+// acks each one it gets. Once the Tx got an ack it sets the confirmed flag in the following
+// announcements, and then switches. The Rx switches only if it got a confirmed announcement.
+// The switch happens right before the Tx sends the frame at the agreed frame index.
+// - no ack: neither side switches, the Tx tries again later
+// - an ack arriving with less than MODE_ADAPTIVE_CONFIRM_CNT_MIN frames to go is ignored, so that the Rx
+//   has at least this many chances to get a confirmed announcement
+// - only if the Rx misses all of these the sides mismatch, the link then times out and both sides
+//   fall back to the setup mode
+
+#define MODE_ADAPTIVE_SWITCH_CNT          16 // frames from announcing a switch to doing it
+#define MODE_ADAPTIVE_CONFIRM_CNT_MIN     6 // min number of confirmed announcements
+#define MODE_ADAPTIVE_UP_HOLD_SEC         3 // secs the conditions for a faster mode must hold
+
+
+class tModeAdaptive
+{
+  public:
+    void Init(uint8_t _mode_base)
+    {
+        mode_base = _mode_base;
+        mode_slowest = (mode_base == MODE_50HZ || mode_base == MODE_31HZ) ? MODE_19HZ : mode_base;
+
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        up_cnt = 0;
+    }
+
+    uint8_t ModeBase(void)
+    {
+        return mode_base;
+    }
+
+    bool Enabled(void)
+    {
+        return (mode_slowest != mode_base);
+    }
+
+    // called once per sec while connected, margin_db is the rssi margin above receiver sensitivity
+    // returns the mode to switch to, or the current mode
+    uint8_t Update1Hz(uint8_t mode, uint8_t LQ, int16_t margin_db)
+    {
+        if (mode < mode_base || mode > mode_slowest) return mode; // should not happen
+
+        if (LQ < MODE_ADAPTIVE_LQ_DOWN) {
+            up_cnt = 0;
+            if (mode >= mode_slowest) return mode;
+            return mode + 1; // next slower
+        }
+
+        if (LQ >= MODE_ADAPTIVE_LQ_UP && margin_db > MODE_ADAPTIVE_MARGIN_UP_DB && mode > mode_base) {
+            up_cnt++;
+            if (up_cnt < MODE_ADAPTIVE_UP_HOLD_SEC) return mode;
+            up_cnt = 0;
+            return mode - 1; // next faster
+        }
+
+        up_cnt = 0;
+        return mode;
+    }
+
+  private:
+    uint8_t mode_base;
+    uint8_t mode_slowest;
+    uint8_t up_cnt;
+};
+
+
+#endif // MODE_ADAPTIVE_H
@@ -0,0 +1,113 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// Dynamic Power Control
+//********************************************************
+#ifndef POWER_CONTROL_H
+#define POWER_CONTROL_H
+#pragma once
+
+
+#include <inttypes.h>
+
+
+//-------------------------------------------------------
+// Dynamic Power Control
+//-------------------------------------------------------
+// each side controls its own transmit power, using the rssi with which the other side received its frames
+// - the margin is this rssi minus the receiver sensitivity
+// - power is stepped down slowly by 1 dB while the margin is above target + hysteresis
+// - power is stepped up fast by the missing margin if the margin is below target
+// - if frames are lost, power is set to max
+// the setup power is the max power
+
+#define POWER_CONTROL_DOWN_PERIOD_MS      500 // time between two down steps
+#define POWER_CONTROL_UP_HOLD_CNT         3 // frames to wait after an up step, for the rssi to catch up
+#define POWER_CONTROL_LOST_CNT            3 // number of lost frames in a row which trigger max power
+
+
+class tPowerControl
+{
+  public:
+    void Init(int8_t _power_max_dbm, int8_t _power_min_dbm, uint16_t frame_rate_ms)
+    {
+        power_max_dbm = _power_max_dbm;
+        power_min_dbm = _power_min_dbm;
+        if (power_min_dbm > power_max_dbm) power_min_dbm = power_max_dbm;
+        down_period = POWER_CONTROL_DOWN_PERIOD_MS / frame_rate_ms;
+
+        Reset();
+    }
+
+    // returns true if power has changed
+    bool Reset(void)
+    {
+        down_cnt = 0;
+        hold_cnt = 0;
+        lost_cnt = 0;
+
+        if (power_dbm == power_max_dbm) return false;
+        power_dbm = power_max_dbm;
+        return true;
+    }
+
+    // called once per frame, received_rssi is the rssi with which the other side got our last frame
+    // returns true if power has changed
+    bool Update(bool valid, int8_t received_rssi, int16_t sensitivity_dbm)
+    {
+        if (!valid || received_rssi == RSSI_INVALID) {
+            lost_cnt++;
+            if (lost_cnt < POWER_CONTROL_LOST_CNT) return false;
+            return Reset();
+        }
+        lost_cnt = 0;
+
+        if (hold_cnt) {
+            hold_cnt--;
+            return false;
+        }
+
+        int16_t margin = (int16_t)received_rssi - sensitivity_dbm;
+
+        if (margin < POWER_CONTROL_MARGIN_DB) {
+            down_cnt = 0;
+            if (power_dbm >= power_max_dbm) return false;
+            int16_t power_new = (int16_t)power_dbm + (POWER_CONTROL_MARGIN_DB - margin);
+            power_dbm = (power_new > power_max_dbm) ? power_max_dbm : power_new;
+            hold_cnt = POWER_CONTROL_UP_HOLD_CNT;
+            return true;
+        }
+
+        if (margin > POWER_CONTROL_MARGIN_DB + POWER_CONTROL_HYSTERESIS_DB) {
+            down_cnt++;
+            if (down_cnt < down_period) return false;
+            down_cnt = 0;
+            if (power_dbm <= power_min_dbm) return false;
+            power_dbm--;
+            return true;
+        }
+
+        down_cnt = 0;
+        return false;
+    }
+
+    int8_t Power_dbm(void)
+    {
+        return power_dbm;
+    }
+
+  private:
+    int8_t power_max_dbm;
+    int8_t power_min_dbm;
+    int8_t power_dbm;
+    uint16_t down_period;
+    uint16_t down_cnt;
+    uint8_t hold_cnt;
+    uint8_t lost_cnt;
+};
+
+
+#endif // POWER_CONTROL_H
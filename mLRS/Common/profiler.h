@@ -0,0 +1,168 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// Main Loop Profiler
+//********************************************************
+#ifndef PROFILER_H
+#define PROFILER_H
+#pragma once
+
+
+#include <inttypes.h>
+
+
+extern uint16_t micros(void);
+
+
+//-------------------------------------------------------
+// Main Loop Profiler
+//-------------------------------------------------------
+// records avg and max time per section of the main loop, the loop frequency and max loop time,
+// and overruns of the while transmit window
+// uses the DWT cycle counter where available, and micros() else (e.g. on F0)
+// the Tx shows the results with the CLI command "perf", the Rx prints them to dbg once per sec
+// reading the results restarts the recording
+
+#if defined __CORTEX_M && (__CORTEX_M >= 3)
+  #define PROFILER_USE_DWT
+#endif
+
+typedef enum {
+    PROFILE_SYSTASK = 0,
+    PROFILE_SX,
+    PROFILE_FRAME, // Tx: doPreTransmit, Rx: doPostReceive
+    PROFILE_CHANNELS, // Tx: channels, mbridge, crsf, in, Rx: doPostReceive2, out
+    PROFILE_MAVLINK,
+    PROFILE_WHILE, // Tx: while transmit, i.e. cli and display
+    PROFILE_TASKS, // Tx: cli, display and esp tasks
+    PROFILE_NUM,
+} PROFILE_ENUM;
+
+const char* profile_section_names[PROFILE_NUM] = {
+    "systask", "sx", "frame", "channels", "mavlink", "while", "tasks",
+};
+
+
+class tProfiler
+{
+  public:
+    void Init(void)
+    {
+#ifdef PROFILER_USE_DWT
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        ticks_per_us = SystemCoreClock / 1000000;
+#endif
+        loop_tlast = ticks();
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        for (uint8_t i = 0; i < PROFILE_NUM; i++) {
+            section[i].cnt = 0;
+            section[i].sum_us = 0;
+            section[i].max_us = 0;
+        }
+        loop_cnt = 0;
+        loop_max_us = 0;
+        loop_tstart_ms = millis32();
+        overrun_cnt = 0;
+        overrun_max_us = 0;
+    }
+
+    // called at the start of each main loop iteration
+    void Loop(void)
+    {
+        uint32_t tnow = ticks();
+        uint32_t dt_us = ticks_to_us(tnow - loop_tlast);
+        loop_tlast = tnow;
+
+        loop_cnt++;
+        if (dt_us > loop_max_us) loop_max_us = dt_us;
+    }
+
+    void Start(uint8_t i)
+    {
+        section[i].tstart = ticks();
+    }
+
+    void End(uint8_t i)
+    {
+        uint32_t dt_us = ticks_to_us(ticks() - section[i].tstart);
+
+        section[i].cnt++;
+        section[i].sum_us += dt_us;
+        if (dt_us > section[i].max_us) section[i].max_us = dt_us;
+    }
+
+    // called when a while task ran longer than its window, dt_us is the excess time
+    void Overrun(int32_t dt_us)
+    {
+        overrun_cnt++;
+        if (dt_us > overrun_max_us) overrun_max_us = dt_us;
+    }
+
+    uint32_t SectionAvg_us(uint8_t i) { return (section[i].cnt) ? section[i].sum_us / section[i].cnt : 0; }
+    uint32_t SectionMax_us(uint8_t i) { return section[i].max_us; }
+
+    uint32_t LoopFrequency_hz(void)
+    {
+        uint32_t dt_ms = millis32() - loop_tstart_ms;
+        return (dt_ms) ? ((uint64_t)loop_cnt * 1000) / dt_ms : 0;
+    }
+
+    uint32_t loop_max_us;
+    uint16_t overrun_cnt;
+    int32_t overrun_max_us;
+
+  private:
+    uint32_t ticks(void)
+    {
+#ifdef PROFILER_USE_DWT
+        return DWT->CYCCNT;
+#else
+        return micros(); // 16 bit, is fine for sections shorter than 65 ms
+#endif
+    }
+
+    uint32_t ticks_to_us(uint32_t dt)
+    {
+#ifdef PROFILER_USE_DWT
+        return dt / ticks_per_us;
+#else
+        return (uint16_t)dt;
+#endif
+    }
+
+    struct {
+        uint32_t tstart;
+        uint32_t cnt;
+        uint32_t sum_us;
+        uint32_t max_us;
+    } section[PROFILE_NUM];
+
+#ifdef PROFILER_USE_DWT
+    uint32_t ticks_per_us;
+#endif
+    uint32_t loop_tlast;
+    uint32_t loop_cnt;
+    uint32_t loop_tstart_ms;
+};
+
+
+#ifdef USE_PROFILER
+  #define PROFILE_LOOP()        profiler.Loop()
+  #define PROFILE_START(i)      profiler.Start(i)
+  #define PROFILE_END(i)        profiler.End(i)
+#else
+  #define PROFILE_LOOP()
+  #define PROFILE_START(i)
+  #define PROFILE_END(i)
+#endif
+
+
+#endif // PROFILER_H
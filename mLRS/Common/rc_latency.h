@@ -0,0 +1,168 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// RC Latency Measurement
+//********************************************************
+#ifndef RC_LATENCY_H
+#define RC_LATENCY_H
+#pragma once
+
+
+#include <inttypes.h>
+#include <string.h>
+
+
+//-------------------------------------------------------
+// RC Latency Measurement
+//-------------------------------------------------------
+// measures the latency from the rc data arriving at the Tx to it being send out by the Rx
+// - the Tx time stamps rc data when it is ingested, and puts the age of the rc data at the time
+//   the frame is transmitted into the Tx frame, in place of LQ_serial_data, which the Rx doesn't use
+// - the Rx adds the time over air and the time from the RX_DONE to the output of the rc data
+// - the Rx collects min, avg, max, std dev and a histogram, and reports these once per sec to the Tx
+//   with FRAME_CMD_RX_RC_LATENCY, they can be viewed with the CLI command "lat"
+// the time the output needs to send the rc data, e.g. sbus, is not included
+
+#define RC_LATENCY_AGE_UNIT_US    500 // resolution of the age marker
+#define RC_LATENCY_AGE_INVALID    127 // 7 bits, also used if rc data is older than ca 63 ms
+#define RC_LATENCY_HIST_BIN_US    4000
+#define RC_LATENCY_HIST_NUM       16 // the last bin collects all larger values
+
+
+class tRcLatency
+{
+  public:
+    void Init(void)
+    {
+        ingest_valid = false;
+        received_valid = false;
+        report_valid = false;
+        Reset();
+    }
+
+    //-- Tx side
+
+    // called then new rc data is available
+    void Ingest(uint16_t tnow_us, uint32_t tnow_ms)
+    {
+        ingest_us = tnow_us;
+        ingest_ms = tnow_ms;
+        ingest_valid = true;
+    }
+
+    // age marker of the current rc data, called then the frame is transmitted
+    uint8_t AgeMarker(uint16_t tnow_us, uint32_t tnow_ms)
+    {
+        if (!ingest_valid || (tnow_ms - ingest_ms) > 60) return RC_LATENCY_AGE_INVALID;
+        uint16_t age = (uint16_t)(tnow_us - ingest_us) / RC_LATENCY_AGE_UNIT_US;
+        return (age < RC_LATENCY_AGE_INVALID) ? age : RC_LATENCY_AGE_INVALID;
+    }
+
+    // report received from the Rx
+    void SetReport(tRxCmdFrameRcLatency* _report)
+    {
+        memcpy(&report, _report, sizeof(tRxCmdFrameRcLatency));
+        report_valid = true;
+    }
+
+    bool GetReport(tRxCmdFrameRcLatency* _report)
+    {
+        if (!report_valid) return false;
+        memcpy(_report, &report, sizeof(tRxCmdFrameRcLatency));
+        return true;
+    }
+
+    //-- Rx side
+
+    // called for frames with valid rc data
+    void Received(uint8_t age_marker, uint16_t rx_done_10us)
+    {
+        received_age_marker = age_marker;
+        received_rx_done_10us = rx_done_10us;
+        received_valid = (age_marker < RC_LATENCY_AGE_INVALID);
+    }
+
+    // called then the rc data is output, if the rc data is from a frame received in this slot
+    void Output(bool frame_missed, uint16_t tnow_10us, uint32_t time_over_air_us)
+    {
+        if (frame_missed || !received_valid) { received_valid = false; return; }
+        received_valid = false;
+
+        uint32_t latency_us = (uint32_t)received_age_marker * RC_LATENCY_AGE_UNIT_US + time_over_air_us +
+                              (uint32_t)(uint16_t)(tnow_10us - received_rx_done_10us) * 10;
+        if (latency_us > UINT16_MAX) latency_us = UINT16_MAX;
+
+        cnt++;
+        sum += latency_us;
+        sum2 += latency_us * latency_us;
+        if (latency_us < min_us) min_us = latency_us;
+        if (latency_us > max_us) max_us = latency_us;
+        uint8_t bin = latency_us / RC_LATENCY_HIST_BIN_US;
+        hist[(bin < RC_LATENCY_HIST_NUM) ? bin : RC_LATENCY_HIST_NUM - 1]++;
+    }
+
+    // fills the report and starts a new period
+    void Report(tRxCmdFrameRcLatency* _report)
+    {
+        _report->cnt = cnt;
+        if (cnt) {
+            uint32_t avg = sum / cnt;
+            uint64_t var = sum2 / cnt - (uint64_t)avg * avg;
+            _report->min_us = min_us;
+            _report->avg_us = avg;
+            _report->max_us = max_us;
+            _report->std_us = isqrt(var);
+            for (uint8_t i = 0; i < RC_LATENCY_HIST_NUM; i++) _report->hist[i] = ((uint32_t)hist[i] * 100 + cnt/2) / cnt;
+        } else {
+            _report->min_us = _report->avg_us = _report->max_us = _report->std_us = 0;
+            memset(_report->hist, 0, RC_LATENCY_HIST_NUM);
+        }
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        cnt = 0;
+        sum = 0;
+        sum2 = 0;
+        min_us = UINT16_MAX;
+        max_us = 0;
+        memset(hist, 0, sizeof(hist));
+    }
+
+  private:
+    uint16_t isqrt(uint64_t x)
+    {
+        uint32_t r = 0;
+        for (uint32_t bit = (uint32_t)1 << 15; bit; bit >>= 1) {
+            uint32_t t = r | bit;
+            if ((uint64_t)t * t <= x) r = t;
+        }
+        return r;
+    }
+
+    // Tx side
+    uint16_t ingest_us;
+    uint32_t ingest_ms;
+    bool ingest_valid;
+    tRxCmdFrameRcLatency report;
+    bool report_valid;
+
+    // Rx side
+    uint8_t received_age_marker;
+    uint16_t received_rx_done_10us;
+    bool received_valid;
+
+    uint16_t cnt;
+    uint32_t sum;
+    uint64_t sum2;
+    uint16_t min_us;
+    uint16_t max_us;
+    uint16_t hist[RC_LATENCY_HIST_NUM];
+};
+
+
+#endif // RC_LATENCY_H
@@ -52,10 +52,10 @@ void setup_configure_metadata(void)
     SetupMetaData.FrequencyBand_allowed_mask = 0b100000; // only 866 MHz IN, not editable
 #endif
 
-    //-- Mode: "50 Hz,31 Hz,19 Hz,FLRC"
+    //-- Mode: "50 Hz,31 Hz,19 Hz,FLRC,100 Hz"
 #ifdef DEVICE_HAS_SX128x
 #ifndef MLRS_DEV_FEATURE_FLRC
-    SetupMetaData.Mode_allowed_mask = 0b0111; // only 50 Hz, 31 Hz, 19 Hz
+    SetupMetaData.Mode_allowed_mask = 0b10111; // only 50 Hz, 31 Hz, 19 Hz, 100 Hz
 #else
     SetupMetaData.Mode_allowed_mask = UINT16_MAX; // all
 #endif
@@ -470,24 +470,37 @@ void configure_mode(uint8_t mode)
         Config.send_frame_tmo_ms = MODE_FLRC_SEND_FRAME_TMO_MS; // 3;
         break;
 
+    case MODE_100HZ:
+        Config.frame_rate_ms = 10; // 10 ms = 100 Hz
+        Config.frame_rate_hz = 100;
+        Config.LoraConfigIndex = SX128x_LORA_CONFIG_BW800_SF5_CRLI4_5;
+        Config.send_frame_tmo_ms = MODE_100HZ_SEND_FRAME_TMO_MS; // 5
+        break;
+
     default:
         while (1) {} // must not happen, should have been resolved in setup_sanitize()
 
     }
-}
 
+    // the 100 Hz mode uses slim frames, these carry less serial payload
+    switch (Config.Mode) {
+    case MODE_100HZ:
+        Config.frame_len = FRAME_TX_RX_SLIM_LEN;
+        break;
+    default:
+        Config.frame_len = FRAME_TX_RX_LEN;
+    }
+    Config.frame_tx_payload_len = FRAME_TX_PAYLOAD_LEN - (FRAME_TX_RX_LEN - Config.frame_len);
+    Config.frame_rx_payload_len = FRAME_RX_PAYLOAD_LEN - (FRAME_TX_RX_LEN - Config.frame_len);
 
-void setup_configure_config(uint8_t config_id)
-{
-    //-- SyncWord
-    // note: FrameSyncWord will be modified below by Ortho
-
-    uint32_t bind_dblword = u32_from_bindphrase(Setup.Common[config_id].BindPhrase);
-
-    Config.FrameSyncWord = fmav_crc_calculate((uint8_t*)&bind_dblword, 4); // condense it into a u16
+    Config.LQAveragingPeriod = (LQ_AVERAGING_MS/Config.frame_rate_ms);
+    if (Config.LQAveragingPeriod > LQ_COUNTER_PERIOD_MAX) Config.LQAveragingPeriod = LQ_COUNTER_PERIOD_MAX; // play it safe
+}
 
-    Config.FlrcSyncWord = bind_dblword;
 
+// the part of the config which can be changed while running
+void setup_configure_live_config(uint8_t config_id)
+{
     //-- Power
 
     // note: the actually used power will be determined later when the SX are set up
@@ -498,6 +511,40 @@ void setup_configure_config(uint8_t config_id)
     Config.Power_dbm = rfpower_list[Setup.Rx.Power].dbm;
 #endif
 
+    //-- Serial
+#ifdef DEVICE_IS_TRANSMITTER
+    switch (Setup.Tx[config_id].SerialBaudrate) {
+#endif
+#ifdef DEVICE_IS_RECEIVER
+    switch (Setup.Rx.SerialBaudrate) {
+#endif
+    case SERIAL_BAUDRATE_9600: Config.SerialBaudrate = 9600; break;
+    case SERIAL_BAUDRATE_19200: Config.SerialBaudrate = 19200; break;
+    case SERIAL_BAUDRATE_38400: Config.SerialBaudrate = 38400; break;
+    case SERIAL_BAUDRATE_57600: Config.SerialBaudrate = 57600; break;
+    case SERIAL_BAUDRATE_115200: Config.SerialBaudrate = 115200; break;
+    case SERIAL_BAUDRATE_230400: Config.SerialBaudrate = 230400; break;
+    default:
+#ifdef DEVICE_IS_TRANSMITTER
+        Config.SerialBaudrate = 115200;
+#else
+        Config.SerialBaudrate = 57600;
+#endif
+    }
+}
+
+
+void setup_configure_config(uint8_t config_id)
+{
+    //-- SyncWord
+    // note: FrameSyncWord will be modified below by Ortho
+
+    uint32_t bind_dblword = u32_from_bindphrase(Setup.Common[config_id].BindPhrase);
+
+    Config.FrameSyncWord = fmav_crc_calculate((uint8_t*)&bind_dblword, 4); // condense it into a u16
+
+    Config.FlrcSyncWord = bind_dblword;
+
   //-- Diversity
 
 #ifdef DEVICE_HAS_DIVERSITY
@@ -561,6 +608,7 @@ void setup_configure_config(uint8_t config_id)
         case MODE_31HZ: Config.FhssNum = FHSS_NUM_BAND_2P4_GHZ_31HZ_MODE; break;
         case MODE_19HZ: Config.FhssNum = FHSS_NUM_BAND_2P4_GHZ_19HZ_MODE; break;
         case MODE_FLRC_DEV: Config.FhssNum = FHSS_NUM_BAND_2P4_GHZ; break;
+        case MODE_100HZ: Config.FhssNum = FHSS_NUM_BAND_2P4_GHZ; break;
         default:
             while (1) {} // must not happen, should have been resolved in setup_sanitize()
         }
@@ -594,28 +642,9 @@ void setup_configure_config(uint8_t config_id)
     Config.connect_tmo_systicks = SYSTICK_DELAY_MS(CONNECT_TMO_MS);
     Config.connect_listen_hop_cnt = (uint8_t)(1.5f * Config.FhssNum);
 
-    Config.LQAveragingPeriod = (LQ_AVERAGING_MS/Config.frame_rate_ms);
+    //-- Power, Serial
 
-    //-- Serial
-#ifdef DEVICE_IS_TRANSMITTER
-    switch (Setup.Tx[config_id].SerialBaudrate) {
-#endif
-#ifdef DEVICE_IS_RECEIVER
-    switch (Setup.Rx.SerialBaudrate) {
-#endif
-    case SERIAL_BAUDRATE_9600: Config.SerialBaudrate = 9600; break;
-    case SERIAL_BAUDRATE_19200: Config.SerialBaudrate = 19200; break;
-    case SERIAL_BAUDRATE_38400: Config.SerialBaudrate = 38400; break;
-    case SERIAL_BAUDRATE_57600: Config.SerialBaudrate = 57600; break;
-    case SERIAL_BAUDRATE_115200: Config.SerialBaudrate = 115200; break;
-    case SERIAL_BAUDRATE_230400: Config.SerialBaudrate = 230400; break;
-    default:
-#ifdef DEVICE_IS_TRANSMITTER
-        Config.SerialBaudrate = 115200;
-#else
-        Config.SerialBaudrate = 57600;
-#endif
-    }
+    setup_configure_live_config(config_id);
 
     //-- Mbridge, Crsf
 
@@ -666,6 +695,51 @@ void setup_reload(void)
 }
 
 
+//-------------------------------------------------------
+// Live parameter changes
+//-------------------------------------------------------
+// changes of parameters which affect the link, the radios, or how the peripherals are set up need a restart
+// all others are applied while running, and the setup is then stored without a restart
+// we keep a copy of the setup as it is in use, to find out what has changed
+
+tCommonSetup SetupInUse_Common;
+#ifdef DEVICE_IS_TRANSMITTER
+tTxSetup SetupInUse_Tx;
+#endif
+#ifdef DEVICE_IS_RECEIVER
+tRxSetup SetupInUse_Rx;
+#endif
+
+
+void setup_set_in_use(void)
+{
+    memcpy(&SetupInUse_Common, &(Setup.Common[Config.ConfigId]), sizeof(tCommonSetup));
+#ifdef DEVICE_IS_TRANSMITTER
+    memcpy(&SetupInUse_Tx, &(Setup.Tx[Config.ConfigId]), sizeof(tTxSetup));
+#endif
+#ifdef DEVICE_IS_RECEIVER
+    memcpy(&SetupInUse_Rx, &(Setup.Rx), sizeof(tRxSetup));
+#endif
+}
+
+
+bool setup_needs_restart(void)
+{
+    if (memcmp(&SetupInUse_Common, &(Setup.Common[Config.ConfigId]), sizeof(tCommonSetup)) != 0) return true;
+#ifdef DEVICE_IS_TRANSMITTER
+    if (Setup._ConfigId != Config.ConfigId) return true;
+    if (Setup.Tx[Config.ConfigId].Diversity != SetupInUse_Tx.Diversity) return true;
+    if (Setup.Tx[Config.ConfigId].ChannelsSource != SetupInUse_Tx.ChannelsSource) return true; // affects mbridge, crsf
+    if (Setup.Tx[Config.ConfigId].SerialDestination != SetupInUse_Tx.SerialDestination) return true; // affects mbridge, crsf
+#endif
+#ifdef DEVICE_IS_RECEIVER
+    if (Setup.Rx.Diversity != SetupInUse_Rx.Diversity) return true;
+    if (Setup.Rx.SerialLinkMode != SetupInUse_Rx.SerialLinkMode) return true; // affects mavlink and the packers on both sides
+#endif
+    return false;
+}
+
+
 //-------------------------------------------------------
 // Init
 //-------------------------------------------------------
@@ -745,6 +819,8 @@ bool doEEPROMwrite;
     setup_sanitize_config(Config.ConfigId);
 
     setup_configure_config(Config.ConfigId);
+
+    setup_set_in_use();
 }
 
 
@@ -53,11 +53,7 @@
 #define SETUP_OPT_RX_SERIAL_BAUDRATE  "9600,19200,38400,57600,115200,230400"
 #define SETUP_OPT_SERIAL_LINK_MODE    "transp.,mavlink"
 
-#ifndef MLRS_DEV_FEATURE_FLRC
-#define SETUP_OPT_RFMODE              "50 Hz,31 Hz,19 Hz"
-#else
-#define SETUP_OPT_RFMODE              "50 Hz,31 Hz,19 Hz,FLRC"
-#endif
+#define SETUP_OPT_RFMODE              "50 Hz,31 Hz,19 Hz,FLRC,100 Hz" // FLRC is masked out if not MLRS_DEV_FEATURE_FLRC
 
 #define SETUP_OPT_RFBAND              "2.4,915 FCC,868,433,70,866 IN" // used below in LIST_COMMON
 #define SETUP_OPT_RF_BAND_LONGSTR     "2.4 GHz,915 MHz FCC,868 MHz,433 MHz,70 cm HAM,866 MHz IN" // used e.g. in cli
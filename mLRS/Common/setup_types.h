@@ -37,6 +37,7 @@ typedef enum {
     MODE_31HZ,
     MODE_19HZ,
     MODE_FLRC_DEV,
+    MODE_100HZ, // appended, so that stored setups keep their mode
     MODE_NUM,
 } MODE_ENUM;
 
@@ -358,6 +359,10 @@ typedef struct
     uint8_t LoraConfigIndex;
     uint8_t send_frame_tmo_ms;
 
+    uint8_t frame_len; // FRAME_TX_RX_LEN, or shorter for slim frames
+    uint8_t frame_tx_payload_len;
+    uint8_t frame_rx_payload_len;
+
     uint32_t FlrcSyncWord;
 
     uint16_t FrameSyncWord;
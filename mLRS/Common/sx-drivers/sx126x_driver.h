@@ -27,31 +27,45 @@ typedef struct {
     uint8_t CrcEnabled;
     uint8_t InvertIQ;
     uint32_t TimeOverAir; // in us
+    uint16_t TimeOverAirPerByte; // in us
+    uint16_t TimeOverAirHeader; // in us, is added by the explicit header
     int16_t ReceiverSensitivity;
 } tSxLoraConfiguration;
 
 
+// with variable frame length the receiver needs to get the frame length, so the header must be enabled
+#ifdef USE_VARIABLE_FRAME_LEN
+#define SX126X_LORA_HEADER_MODE  SX126X_LORA_HEADER_ENABLE
+#else
+#define SX126X_LORA_HEADER_MODE  SX126X_LORA_HEADER_DISABLE
+#endif
+
+
 const tSxLoraConfiguration Sx126xLoraConfiguration[] = {
     { .SpreadingFactor = SX126X_LORA_SF5,
       .Bandwidth = SX126X_LORA_BW_500,
       .CodingRate = SX126X_LORA_CR_4_5,
       .PreambleLength = 12,
-      .HeaderType = SX126X_LORA_HEADER_DISABLE,
+      .HeaderType = SX126X_LORA_HEADER_MODE,
       .PayloadLength = FRAME_TX_RX_LEN,
       .CrcEnabled = SX126X_LORA_CRC_DISABLE,
       .InvertIQ = SX126X_LORA_IQ_NORMAL,
       .TimeOverAir = 13200,
+      .TimeOverAirPerByte = 128,
+      .TimeOverAirHeader = 320, // 20 bits, one more coding block
       .ReceiverSensitivity = -111,
     },
     { .SpreadingFactor = SX126X_LORA_SF6,
       .Bandwidth = SX126X_LORA_BW_500,
       .CodingRate = SX126X_LORA_CR_4_5,
       .PreambleLength = 12,
-      .HeaderType = SX126X_LORA_HEADER_DISABLE,
+      .HeaderType = SX126X_LORA_HEADER_MODE,
       .PayloadLength = FRAME_TX_RX_LEN,
       .CrcEnabled = SX126X_LORA_CRC_DISABLE,
       .InvertIQ = SX126X_LORA_IQ_NORMAL,
       .TimeOverAir = 22560,
+      .TimeOverAirPerByte = 213,
+      .TimeOverAirHeader = 640, // 20 bits, one more coding block
       .ReceiverSensitivity = -112, // Q: SF5 with CR4/8 would be -111 dBm, 20.1 ms, better option??
     }
 };
@@ -125,6 +139,8 @@ class Sx126xDriverCommon : public Sx126xDriverBase
                         config->CrcEnabled,
                         config->InvertIQ);
 
+        packet_len = config->PayloadLength;
+
         // set LoRaSymbNumTimeout for false detection of preamble
         SetSymbNumTimeout((config->PreambleLength * 3) >> 2);
     }
@@ -148,6 +164,20 @@ class Sx126xDriverCommon : public Sx126xDriverBase
         SetTxParams(sx_power, SX126X_RAMPTIME_10_US);
     }
 
+    // sets the length of the frames to transmit, is a no-op if it is already set
+    void SetPacketLength(uint8_t len)
+    {
+        if (len == packet_len) return;
+
+        SetPacketParams(lora_configuration->PreambleLength,
+                        lora_configuration->HeaderType,
+                        len,
+                        lora_configuration->CrcEnabled,
+                        lora_configuration->InvertIQ);
+
+        packet_len = len;
+    }
+
     void Configure(void)
     {
         SetPacketType(SX126X_PACKET_TYPE_LORA);
@@ -211,17 +241,25 @@ class Sx126xDriverCommon : public Sx126xDriverBase
 
     //-- this are the API functions used in the loop
 
-    void ReadFrame(uint8_t* data, uint8_t len)
+    // returns the number of bytes read
+    uint8_t ReadFrame(uint8_t* data, uint8_t len)
     {
         uint8_t rxStartBufferPointer;
         uint8_t rxPayloadLength;
 
         GetRxBufferStatus(&rxPayloadLength, &rxStartBufferPointer);
+#ifdef USE_VARIABLE_FRAME_LEN
+        if (rxPayloadLength < len) len = rxPayloadLength;
+#endif
         ReadBuffer(rxStartBufferPointer, data, len);
+        return len;
     }
 
     void SendFrame(uint8_t* data, uint8_t len, uint16_t tmo_ms)
     {
+#ifdef USE_VARIABLE_FRAME_LEN
+        SetPacketLength(len);
+#endif
         WriteBuffer(0, data, len);
         ClearIrqStatus(SX126X_IRQ_ALL);
         SetTx(tmo_ms * 64); // 0 = no timeout. TimeOut period inn ms. sx1262 have static 15p625 period base, so for 1 ms needs 64 tmo value
@@ -229,6 +267,9 @@ class Sx126xDriverCommon : public Sx126xDriverBase
 
     void SetToRx(uint16_t tmo_ms)
     {
+#ifdef USE_VARIABLE_FRAME_LEN
+        SetPacketLength(FRAME_TX_RX_LEN); // is the max length in receive
+#endif
         ClearIrqStatus(SX126X_IRQ_ALL);
         SetRx(tmo_ms * 64); // 0 = no timeout
     }
@@ -269,7 +310,19 @@ class Sx126xDriverCommon : public Sx126xDriverBase
     {
         if (lora_configuration == nullptr) config_calc(); // ensure it is set
 
+#ifdef USE_VARIABLE_FRAME_LEN
+        return lora_configuration->TimeOverAir + lora_configuration->TimeOverAirHeader;
+#else
         return lora_configuration->TimeOverAir;
+#endif
+    }
+
+    // time over air of a frame shorter than FRAME_TX_RX_LEN, is accurate to within one coding block
+    uint32_t TimeOverAir_us(uint8_t len)
+    {
+        if (lora_configuration == nullptr) config_calc(); // ensure it is set
+
+        return TimeOverAir_us() - (uint32_t)(FRAME_TX_RX_LEN - len) * lora_configuration->TimeOverAirPerByte;
     }
 
     int16_t ReceiverSensitivity_dbm(void)
@@ -293,6 +346,7 @@ class Sx126xDriverCommon : public Sx126xDriverBase
     const tSxLoraConfiguration* lora_configuration;
     uint8_t sx_power;
     int8_t actual_power_dbm;
+    uint8_t packet_len;
 };
 
 
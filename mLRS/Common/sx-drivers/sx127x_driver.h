@@ -38,6 +38,13 @@ typedef struct {
 } tSxLoraConfiguration;
 
 
+// with variable frame length the receiver needs to get the frame length from the explicit header, but the
+// SX1276 supports SF6 only in implicit header mode
+#ifdef USE_VARIABLE_FRAME_LEN
+  #error USE_VARIABLE_FRAME_LEN is not supported by SX127x, SF6 needs implicit header mode !
+#endif
+
+
 const tSxLoraConfiguration Sx127xLoraConfiguration[] = {
     { .SpreadingFactor = SX1276_LORA_SF6,
       .Bandwidth = SX1276_LORA_BW_500,
@@ -173,13 +180,15 @@ class Sx127xDriverCommon : public Sx127xDriverBase
 
     //-- this are the API functions used in the loop
 
-    void ReadFrame(uint8_t* data, uint8_t len)
+    // returns the number of bytes read
+    uint8_t ReadFrame(uint8_t* data, uint8_t len)
     {
         uint8_t rxStartBufferPointer;
         uint8_t rxPayloadLength;
 
         GetRxBufferStatus(&rxPayloadLength, &rxStartBufferPointer);
         ReadBuffer(rxStartBufferPointer, data, len);
+        return len;
     }
 
     void SendFrame(uint8_t* data, uint8_t len, uint16_t tmo_ms) // SX1276 doesn't have a Tx timeout
@@ -41,6 +41,8 @@ typedef struct {
     uint8_t CrcEnabled;
     uint8_t InvertIQ;
     uint32_t TimeOverAir; // in us
+    uint16_t TimeOverAirPerByte; // in us
+    uint16_t TimeOverAirHeader; // in us, is added by the explicit header
     int16_t ReceiverSensitivity;
 } tSxLoraConfiguration;
 
@@ -57,42 +59,60 @@ typedef struct {
     uint8_t CrcLength;
     uint16_t CrcSeed;
     uint32_t TimeOverAir; // in us
+    uint16_t TimeOverAirPerByte; // in us
+    uint16_t TimeOverAirHeader; // in us, is added by the length header of variable length packets
     int16_t ReceiverSensitivity;
 } tSxFlrcConfiguration;
 
 
+// with variable frame length the receiver needs to get the frame length, so the header must be enabled
+#ifdef USE_VARIABLE_FRAME_LEN
+#define SX1280_LORA_HEADER_MODE       SX1280_LORA_HEADER_ENABLE
+#define SX1280_FLRC_PACKET_TYPE_MODE  SX1280_FLRC_PACKET_TYPE_VARIABLE_LENGTH
+#else
+#define SX1280_LORA_HEADER_MODE       SX1280_LORA_HEADER_DISABLE
+#define SX1280_FLRC_PACKET_TYPE_MODE  SX1280_FLRC_PACKET_TYPE_FIXED_LENGTH
+#endif
+
+
 const tSxLoraConfiguration Sx128xLoraConfiguration[] = {
     { .SpreadingFactor = SX1280_LORA_SF5,
       .Bandwidth = SX1280_LORA_BW_800,
       .CodingRate = SX1280_LORA_CR_LI_4_5,
       .PreambleLength = 12,
-      .HeaderType = SX1280_LORA_HEADER_DISABLE,
+      .HeaderType = SX1280_LORA_HEADER_MODE,
       .PayloadLength = FRAME_TX_RX_LEN,
       .CrcEnabled = SX1280_LORA_CRC_DISABLE,
       .InvertIQ = SX1280_LORA_IQ_NORMAL,
       .TimeOverAir = 7892,
+      .TimeOverAirPerByte = 79,
+      .TimeOverAirHeader = 197, // 20 bits, one more coding block
       .ReceiverSensitivity = -105,
     },
     { .SpreadingFactor = SX1280_LORA_SF6,
       .Bandwidth = SX1280_LORA_BW_800,
       .CodingRate = SX1280_LORA_CR_LI_4_5,
       .PreambleLength = 12,
-      .HeaderType = SX1280_LORA_HEADER_DISABLE,
+      .HeaderType = SX1280_LORA_HEADER_MODE,
       .PayloadLength = FRAME_TX_RX_LEN,
       .CrcEnabled = SX1280_LORA_CRC_DISABLE,
       .InvertIQ = SX1280_LORA_IQ_NORMAL,
       .TimeOverAir = 13418,
+      .TimeOverAirPerByte = 131,
+      .TimeOverAirHeader = 394, // 20 bits, one more coding block
       .ReceiverSensitivity = -108,
     },
     { .SpreadingFactor = SX1280_LORA_SF7,
       .Bandwidth = SX1280_LORA_BW_800,
       .CodingRate = SX1280_LORA_CR_LI_4_5,
       .PreambleLength = 12,
-      .HeaderType = SX1280_LORA_HEADER_DISABLE,
+      .HeaderType = SX1280_LORA_HEADER_MODE,
       .PayloadLength = FRAME_TX_RX_LEN,
       .CrcEnabled = SX1280_LORA_CRC_DISABLE,
       .InvertIQ = SX1280_LORA_IQ_NORMAL,
       .TimeOverAir = 23527,
+      .TimeOverAirPerByte = 225,
+      .TimeOverAirHeader = 0, // 20 bits, fit into the last coding block
       .ReceiverSensitivity = -112,
     }
 };
@@ -105,11 +125,13 @@ const tSxFlrcConfiguration Sx128xFlrcConfiguration[] = {
       .AGCPreambleLength = SX1280_FLRC_PREAMBLE_LENGTH_32_BITS,
       .SyncWordLength = SX1280_FLRC_SYNCWORD_LEN_P32S,
       .SyncWordMatch = SX1280_FLRC_SYNCWORD_MATCH_1,
-      .PacketType = SX1280_FLRC_PACKET_TYPE_FIXED_LENGTH,
+      .PacketType = SX1280_FLRC_PACKET_TYPE_MODE,
       .PayloadLength = FRAME_TX_RX_LEN,
       .CrcLength = SX1280_FLRC_CRC_DISABLE,
       .CrcSeed = 27368, // CrcSeed is 'j', 'p'. Not used.
       .TimeOverAir = 1631,
+      .TimeOverAirPerByte = 16,
+      .TimeOverAirHeader = 33, // 2 bytes
       .ReceiverSensitivity = -103,
     }
 };
@@ -164,9 +186,11 @@ class Sx128xDriverCommon : public Sx128xDriverBase
 
         SetPacketParams(config->PreambleLength,
                         config->HeaderType,
-                        config->PayloadLength,
+                        Config.frame_len, // is shorter than config->PayloadLength for slim frames
                         config->CrcEnabled,
                         config->InvertIQ);
+
+        packet_len = Config.frame_len;
     }
 
     void SetLoraConfigurationByIndex(uint8_t index)
@@ -195,11 +219,14 @@ class Sx128xDriverCommon : public Sx128xDriverBase
                             config->SyncWordLength,
                             config->SyncWordMatch,
                             config->PacketType,
-                            config->PayloadLength,
+                            Config.frame_len, // is shorter than config->PayloadLength for slim frames
                             config->CrcLength,
                             config->CrcSeed,
                             sync_word,
                             config->CodingRate);
+
+        packet_len = Config.frame_len;
+        flrc_sync_word = sync_word;
     }
 
     void SetFlrcConfigurationByIndex(uint8_t index, uint32_t sync_word)
@@ -216,6 +243,32 @@ class Sx128xDriverCommon : public Sx128xDriverBase
         SetTxParams(sx_power, SX1280_RAMPTIME_04_US);
     }
 
+    // sets the length of the frames to transmit, is a no-op if it is already set
+    void SetPacketLength(uint8_t len)
+    {
+        if (len == packet_len) return;
+
+        if (Config.modeIsLora()) {
+            SetPacketParams(lora_configuration->PreambleLength,
+                            lora_configuration->HeaderType,
+                            len,
+                            lora_configuration->CrcEnabled,
+                            lora_configuration->InvertIQ);
+        } else {
+            SetPacketParamsFLRC(flrc_configuration->AGCPreambleLength,
+                                flrc_configuration->SyncWordLength,
+                                flrc_configuration->SyncWordMatch,
+                                flrc_configuration->PacketType,
+                                len,
+                                flrc_configuration->CrcLength,
+                                flrc_configuration->CrcSeed,
+                                flrc_sync_word,
+                                flrc_configuration->CodingRate);
+        }
+
+        packet_len = len;
+    }
+
     void Configure(void)
     {
         if (Config.modeIsLora()) {
@@ -256,7 +309,8 @@ class Sx128xDriverCommon : public Sx128xDriverBase
 
     //-- this are the API functions used in the loop
 
-    void ReadFrame(uint8_t* data, uint8_t len)
+    // returns the number of bytes read
+    uint8_t ReadFrame(uint8_t* data, uint8_t len)
     {
         uint8_t rxStartBufferPointer;
         uint8_t rxPayloadLength;
@@ -265,11 +319,18 @@ class Sx128xDriverCommon : public Sx128xDriverBase
         GetRxBufferStatus(&rxPayloadLength, &rxStartBufferPointer);
         // if one wants it, it could be obtained from what had been set
         // rxPayloadLength = ReadRegister(SX1280_REG_PayloadLength);
+#ifdef USE_VARIABLE_FRAME_LEN
+        if (rxPayloadLength < len) len = rxPayloadLength;
+#endif
         ReadBuffer(rxStartBufferPointer, data, len);
+        return len;
     }
 
     void SendFrame(uint8_t* data, uint8_t len, uint16_t tmo_ms)
     {
+#ifdef USE_VARIABLE_FRAME_LEN
+        SetPacketLength(len);
+#endif
         WriteBuffer(0, data, len);
         ClearIrqStatus(SX1280_IRQ_ALL);
         SetTx(SX1280_PERIODBASE_62p5_US, tmo_ms*16); // 0 = no timeout, if a Tx timeout occurs we have a serious problem
@@ -277,6 +338,9 @@ class Sx128xDriverCommon : public Sx128xDriverBase
 
     void SetToRx(uint16_t tmo_ms)
     {
+#ifdef USE_VARIABLE_FRAME_LEN
+        SetPacketLength(Config.frame_len); // is the max length in receive
+#endif
         ClearIrqStatus(SX1280_IRQ_ALL);
         SetRx(SX1280_PERIODBASE_62p5_US, tmo_ms*16); // 0 = no timeout
     }
@@ -325,10 +389,26 @@ class Sx128xDriverCommon : public Sx128xDriverBase
 
     // cumbersome to calculate in general, so use hardcoded for a specific settings
     uint32_t TimeOverAir_us(void)
+    {
+        return TimeOverAir_us(Config.frame_len);
+    }
+
+    // time over air of a frame shorter than FRAME_TX_RX_LEN, is accurate to within one coding block
+    uint32_t TimeOverAir_us(uint8_t len)
     {
         if (lora_configuration == nullptr && flrc_configuration == nullptr) config_calc(); // ensure it is set
 
-        return (Config.modeIsLora()) ? lora_configuration->TimeOverAir : flrc_configuration->TimeOverAir;
+#ifdef USE_VARIABLE_FRAME_LEN
+        if (Config.modeIsLora()) {
+            return lora_configuration->TimeOverAir + lora_configuration->TimeOverAirHeader - (uint32_t)(FRAME_TX_RX_LEN - len) * lora_configuration->TimeOverAirPerByte;
+        }
+        return flrc_configuration->TimeOverAir + flrc_configuration->TimeOverAirHeader - (uint32_t)(FRAME_TX_RX_LEN - len) * flrc_configuration->TimeOverAirPerByte;
+#else
+        if (Config.modeIsLora()) {
+            return lora_configuration->TimeOverAir - (uint32_t)(FRAME_TX_RX_LEN - len) * lora_configuration->TimeOverAirPerByte;
+        }
+        return flrc_configuration->TimeOverAir - (uint32_t)(FRAME_TX_RX_LEN - len) * flrc_configuration->TimeOverAirPerByte;
+#endif
     }
 
     int16_t ReceiverSensitivity_dbm(void)
@@ -350,6 +430,8 @@ class Sx128xDriverCommon : public Sx128xDriverBase
     const tSxFlrcConfiguration* flrc_configuration;
     uint8_t sx_power;
     int8_t actual_power_dbm;
+    uint8_t packet_len;
+    uint32_t flrc_sync_word;
 };
 
 
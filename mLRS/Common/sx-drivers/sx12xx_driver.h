@@ -49,11 +49,12 @@ class SxDriverDummy
     void SetRfFrequency(uint32_t RfFrequency) {}
     void GetPacketStatus(int8_t* RssiSync, int8_t* Snr) {}
     void SendFrame(uint8_t* data, uint8_t len, uint16_t tmo_ms) {}
-    void ReadFrame(uint8_t* data, uint8_t len) {}
+    uint8_t ReadFrame(uint8_t* data, uint8_t len) { return 0; }
     void SetToRx(uint16_t tmo_ms) {}
     void SetToIdle(void) {}
 
     void ResetToLoraConfiguration() {}
+    void SetLoraConfigurationByIndex(uint8_t index) {}
     void SetRfPower_dbm(int8_t power_dbm) {}
     void ClearIrqStatus(uint16_t IrqMask) {}
 
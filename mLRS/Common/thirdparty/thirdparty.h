@@ -17,6 +17,16 @@
 // This code is from betaflight
 // https://github.com/betaflight/betaflight/blob/master/src/main/common/crc.c
 
+// select the crc8 engine, the 256 bytes table is the fastest, the nibble table is for flash-starved targets
+// define CRC8_USE_BITWISE to use the plain bitwise loop
+#if !defined CRC8_USE_TABLE && !defined CRC8_USE_NIBBLE_TABLE && !defined CRC8_USE_BITWISE
+#if defined STM32F103xB || defined STM32F070xB
+  #define CRC8_USE_NIBBLE_TABLE
+#else
+  #define CRC8_USE_TABLE
+#endif
+#endif
+
 uint8_t crc8_calc(uint8_t crc, unsigned char a, uint8_t poly);
 uint8_t crc8_update(uint8_t crc, const void *data, uint32_t length, uint8_t poly);
 
@@ -34,13 +34,21 @@ void WhileBase::Do(void)
 
     if (do_cnt) { // count down
         do_cnt--;
-        if (!do_cnt) { handle_once(); }
+        if (!do_cnt) { handle_once(); check_overrun(); }
         return;
     }
 
-    tremaining_us = dtmax_us() - (int32_t)(micros() - tstart_us);
+    tremaining_us = dtmax_us() - (int32_t)(uint16_t)(micros() - tstart_us);
     if (tremaining_us <= 0) return;
 
     handle();
+    check_overrun();
+}
+
+
+void WhileBase::check_overrun(void)
+{
+    int32_t dt_us = (int32_t)(uint16_t)(micros() - tstart_us) - dtmax_us();
+    if (dt_us > 0) overrun(dt_us);
 }
 
@@ -29,6 +29,9 @@ class WhileBase
     virtual void handle(void) {};
 
     virtual int32_t dtmax_us(void) { return 1; }
+    virtual void overrun(int32_t dt_us) {}; // called when a handler exceeded the window by dt_us
+
+    void check_overrun(void);
 
     uint16_t do_cnt;
     uint16_t tstart_us;
@@ -14,6 +14,14 @@
 // 65 ms would only be 3 packets
 // I have tested it with 1us time base, and it also works fine, but hey
 // Note that TIM2 may be 16 bit or 32 bit depending on which STM32 controller is used
+//
+// the clock is synced to the RX_DONE of received frames, using the time stamp taken at the start of
+// the DIO isr, so that isr latency jitter, SPI transfers and main loop latency do not enter
+// the crystal drift between Tx and Rx is estimated from the RX_DONE time stamps, it is corrected
+// in the isr with a fractional accumulator, which keeps the clock in phase also when frames are lost
+// if the isr is served too late, e.g. because the cpu stalled during a flash write, the next tick
+// would be in the past and the clock would stop until the timer wraps around, so the isr skips
+// whole periods, which keeps the phase, and counts them so that the caller can hop over them
 
 
 #ifndef CLOCK_TIMx
@@ -22,10 +30,16 @@
 
 #define CLOCK_SHIFT_10US          100 // 75 // 100 // 1 ms
 
+#define CLOCK_DRIFT_WINDOW        512 // number of frame periods over which the drift is estimated
+#define CLOCK_DRIFT_MAX_GAP_10US  30000 // time stamps further apart are not used, must be less than 16 bit
+
 
 volatile bool doPostReceive;
 
 uint16_t CLOCK_PERIOD_10US; // does not change while isr is enabled, so no need for volatile
+volatile int32_t clock_drift_q16; // drift per period, in units of 10us/65536
+int32_t clock_drift_acc_q16; // only used in isr
+volatile uint8_t clock_ticks_skipped;
 
 
 //-------------------------------------------------------
@@ -36,12 +50,27 @@ class ClockBase
 {
   public:
     void Init(uint16_t frame_rate_ms);
-    void Reset(void);
+    void SetPeriod(uint16_t frame_rate_ms);
+    void Reset(uint16_t delay_10us = 0);
+    void ResetAt(uint32_t rx_done_10us, uint16_t delay_10us = 0);
+    void Shift(int16_t shift_10us);
+
+    int16_t Drift_ppm(void);
+    uint8_t TicksSkipped(void);
 
     void init_isr_off(void);
     void enable_isr(void);
 
     uint16_t tim_10us(void);
+
+  private:
+    void drift_reset(void);
+    void drift_update(uint16_t rx_done_10us);
+
+    bool drift_last_valid;
+    uint16_t drift_last_10us;
+    int32_t drift_err_sum; // sum of deviations of the time stamps from the period grid
+    uint16_t drift_period_sum; // number of periods in the sum
 };
 
 
@@ -49,18 +78,35 @@ void ClockBase::Init(uint16_t frame_rate_ms)
 {
     CLOCK_PERIOD_10US = frame_rate_ms * 100; // frame rate in units of 10us
     doPostReceive = false;
+    clock_drift_q16 = 0;
+    clock_drift_acc_q16 = 0;
+    clock_ticks_skipped = 0;
+    drift_reset();
 
     init_isr_off();
     enable_isr();
 }
 
 
-void ClockBase::Reset(void)
+// the drift estimate is per period, so is reset when the period changes
+void ClockBase::SetPeriod(uint16_t frame_rate_ms)
+{
+    __disable_irq();
+    CLOCK_PERIOD_10US = frame_rate_ms * 100;
+    clock_drift_q16 = 0;
+    clock_drift_acc_q16 = 0;
+    __enable_irq();
+    drift_reset();
+}
+
+
+// delay_10us allows to shift the clock, e.g. to account for frames with shorter time over air
+void ClockBase::Reset(uint16_t delay_10us)
 {
     if (!CLOCK_PERIOD_10US) while (1) {}
 
     __disable_irq();
-    uint32_t CNT = CLOCK_TIMx->CNT; // works for both 16 and 32 bit timer
+    uint32_t CNT = CLOCK_TIMx->CNT + delay_10us; // works for both 16 and 32 bit timer
     CLOCK_TIMx->CCR1 = CNT + CLOCK_PERIOD_10US;
     CLOCK_TIMx->CCR3 = CNT + CLOCK_SHIFT_10US;
     LL_TIM_ClearFlag_CC1(CLOCK_TIMx); // important to do
@@ -69,6 +115,35 @@ void ClockBase::Reset(void)
 }
 
 
+// as Reset(), but the next tick is relative to the time stamp of the RX_DONE, and not to now
+// doPostReceive is still relative to now, since the frame must have been processed by then
+void ClockBase::ResetAt(uint32_t rx_done_10us, uint16_t delay_10us)
+{
+    if (!CLOCK_PERIOD_10US) while (1) {}
+
+    drift_update(rx_done_10us + delay_10us);
+
+    __disable_irq();
+    uint32_t CNT = CLOCK_TIMx->CNT + delay_10us;
+    CLOCK_TIMx->CCR1 = rx_done_10us + delay_10us + CLOCK_PERIOD_10US;
+    CLOCK_TIMx->CCR3 = CNT + CLOCK_SHIFT_10US;
+    clock_drift_acc_q16 = 0;
+    LL_TIM_ClearFlag_CC1(CLOCK_TIMx);
+    LL_TIM_ClearFlag_CC3(CLOCK_TIMx);
+    __enable_irq();
+}
+
+
+// shifts the next tick, e.g. to account for a change in time over air
+// must be called after a tick and before the next, the period must be set before
+void ClockBase::Shift(int16_t shift_10us)
+{
+    __disable_irq();
+    CLOCK_TIMx->CCR1 = CLOCK_TIMx->CCR1 + shift_10us; // works for both 16 and 32 bit timer
+    __enable_irq();
+}
+
+
 void ClockBase::init_isr_off(void)
 {
     tim_init_up(CLOCK_TIMx, 0xFFFFFFFF, TIMER_BASE_10US); // works for both 16 and 32 bit timer
@@ -97,6 +172,60 @@ uint16_t ClockBase::tim_10us(void)
 }
 
 
+int16_t ClockBase::Drift_ppm(void)
+{
+    return ((int64_t)clock_drift_q16 * 1000000) / ((int32_t)CLOCK_PERIOD_10US * 65536);
+}
+
+
+// returns the number of ticks which were skipped since the last call
+uint8_t ClockBase::TicksSkipped(void)
+{
+    __disable_irq();
+    uint8_t cnt = clock_ticks_skipped;
+    clock_ticks_skipped = 0;
+    __enable_irq();
+    return cnt;
+}
+
+
+void ClockBase::drift_reset(void)
+{
+    drift_last_valid = false;
+    drift_err_sum = 0;
+    drift_period_sum = 0;
+}
+
+
+// the time stamps are quantized to 10 us, but the quantization errors cancel in the sum, so that
+// the resolution is 10 us / CLOCK_DRIFT_WINDOW per period
+void ClockBase::drift_update(uint16_t rx_done_10us)
+{
+    uint16_t dt = rx_done_10us - drift_last_10us; // 16 bit, works for both 16 and 32 bit timer
+    bool last_valid = drift_last_valid;
+
+    drift_last_10us = rx_done_10us;
+    drift_last_valid = true;
+
+    if (!last_valid || dt > CLOCK_DRIFT_MAX_GAP_10US) return;
+
+    uint16_t n = (dt + CLOCK_PERIOD_10US/2) / CLOCK_PERIOD_10US; // number of periods, rounded
+    if (!n) return; // should not happen
+    drift_err_sum += (int32_t)dt - (int32_t)n * CLOCK_PERIOD_10US;
+    drift_period_sum += n;
+
+    if (drift_period_sum < CLOCK_DRIFT_WINDOW) return;
+
+    int32_t drift_q16 = ((int64_t)drift_err_sum * 65536) / drift_period_sum;
+    // the drift is small, a larger value indicates that something went wrong, e.g. a frame was off
+    if (drift_q16 > -(int32_t)CLOCK_PERIOD_10US * 65536 / 1000 && drift_q16 < (int32_t)CLOCK_PERIOD_10US * 65536 / 1000) {
+        clock_drift_q16 = (clock_drift_q16 + drift_q16) / 2;
+    }
+    drift_err_sum = 0;
+    drift_period_sum = 0;
+}
+
+
 //-------------------------------------------------------
 // Clock ISR
 //-------------------------------------------------------
@@ -107,7 +236,16 @@ void CLOCK_IRQHandler(void)
     if (LL_TIM_IsActiveFlag_CC1(CLOCK_TIMx)) { // this is at about when RX was or was supposed to be received
         LL_TIM_ClearFlag_CC1(CLOCK_TIMx);
         CLOCK_TIMx->CCR3 = CLOCK_TIMx->CCR1 + CLOCK_SHIFT_10US; // next doPostReceive
-        CLOCK_TIMx->CCR1 = CLOCK_TIMx->CCR1 + CLOCK_PERIOD_10US; // next tick
+        clock_drift_acc_q16 += clock_drift_q16; // correct for the drift
+        int32_t drift_10us = clock_drift_acc_q16 / 65536;
+        clock_drift_acc_q16 -= drift_10us * 65536;
+        CLOCK_TIMx->CCR1 = CLOCK_TIMx->CCR1 + CLOCK_PERIOD_10US + drift_10us; // next tick
+        // we are late, skip whole periods until the next tick is ahead, 16 bit differences work for both 16 and 32 bit timer
+        while ((int16_t)(CLOCK_TIMx->CCR1 - CLOCK_TIMx->CNT) <= 0) {
+            CLOCK_TIMx->CCR1 = CLOCK_TIMx->CCR1 + CLOCK_PERIOD_10US;
+            if (clock_ticks_skipped < 255) clock_ticks_skipped++;
+        }
+        if ((int16_t)(CLOCK_TIMx->CCR3 - CLOCK_TIMx->CNT) <= 0) doPostReceive = true; // CC3 would not fire
         //LED_GREEN_ON;
     }
     if (LL_TIM_IsActiveFlag_CC3(CLOCK_TIMx)) { // this is 1 ms after RX was or was supposed to be received
@@ -13,8 +13,12 @@
 
 #include "../Common/mavlink/fmav_extension.h"
 #include "../Common/libs/filters.h"
+#include "mavlink_stream_tuning.h"
+#include "mavlink_scheduler.h"
+#include "mavlink_txbuf_controller.h"
 
 static inline bool connected(void);
+static inline uint16_t sx_serial_bytes_held(void);
 
 #define RADIO_LINK_SYSTEM_ID        51 // SiK uses 51, 68
 #define GCS_SYSTEM_ID               255 // default of MissionPlanner, QGC
@@ -37,16 +41,24 @@ class MavlinkBase
     void flush(void);
 
   private:
+    void parse_link_in(char c);
     void send_msg_serial_out(void);
     void generate_radio_status(void);
     void generate_rc_channels_override(void);
     void generate_radio_rc_channels(void);
     void generate_radio_link_stats(void);
     void generate_radio_link_flow_control(void);
+#ifdef USE_MAVLINK_STREAM_TUNING
+    bool handle_stream_tuning(uint32_t tnow_ms);
+    void generate_message_interval(void);
+#endif
 
     uint16_t serial_in_available(void);
     bool handle_txbuf_ardupilot(uint32_t tnow_ms);
     bool handle_txbuf_method_b(uint32_t tnow_ms); // for PX4, aka "brad"
+#ifdef USE_MAVLINK_TXBUF_CONTROLLER
+    bool handle_txbuf_controller(uint32_t tnow_ms);
+#endif
 
     // fields for link in -> serial out parser
     fmav_status_t status_link_in;
@@ -54,6 +66,9 @@ class MavlinkBase
     uint8_t buf_link_in[MAVLINK_BUF_SIZE]; // buffer for link in parser
     fmav_status_t status_serial_out;
     fmav_message_t msg_serial_out;
+#ifdef USE_MAVLINK_COMPRESSION
+    MavlinkUnpacker unpacker_link_in;
+#endif
 
     // to inject RADIO_STATUS or RADIO_LINK_FLOW_CONTROL
     uint32_t radio_status_tlast_ms;
@@ -71,12 +86,34 @@ class MavlinkBase
     } TXBUF_STATE_ENUM;
     uint8_t txbuf_state;
 
+#ifdef USE_MAVLINK_TXBUF_CONTROLLER
+    tTxbufController txbufctrl;
+#endif
+
     // to inject RC_CHANNELS_OVERRIDE or RADIO_RC_CHANNELS & RADIO_LINK_STATS
     bool inject_rc_channels;
     uint16_t rc_chan[16]; // holds the rc data in MAVLink format
     int16_t rc_chan_13b[16]; // holds the rc data in MAVLink RADIO_RC_CHANNELS format
     bool rc_failsafe;
 
+#ifdef USE_MAVLINK_SCHEDULER
+    tMavlinkScheduler scheduler;
+#endif
+
+#ifdef USE_MAVLINK_STREAM_TUNING
+    // fields for serial in parser, to measure the streams
+    fmav_status_t status_serial_in;
+    fmav_result_t result_serial_in;
+    uint8_t buf_serial_in[MAVLINK_BUF_SIZE];
+
+    tMavlinkStreamTuning streamtuning;
+    uint32_t stream_tuning_tlast_ms;
+    uint32_t stream_tuning_capacity_bps;
+    uint32_t stream_tuning_cmd_tlast_ms;
+    uint32_t stream_tuning_msgid;
+    float stream_tuning_interval_us;
+#endif
+
     uint8_t _buf[MAVLINK_BUF_SIZE]; // temporary working buffer, to not burden stack
 };
 
@@ -88,6 +125,9 @@ void MavlinkBase::Init(void)
     result_link_in = {};
     status_link_in = {};
     status_serial_out = {};
+#ifdef USE_MAVLINK_COMPRESSION
+    unpacker_link_in.Init();
+#endif
 
     radio_status_tlast_ms = millis32() + 1000;
     radio_status_txbuf = 0;
@@ -96,10 +136,24 @@ void MavlinkBase::Init(void)
     bytes_serial_in = 0;
     bytes_serial_in_cnt = 0;
     bytes_serial_in_rate_filt.Reset();
+#ifdef USE_MAVLINK_TXBUF_CONTROLLER
+    txbufctrl.Init();
+#endif
 
     inject_rc_channels = false;
     for (uint8_t i = 0; i < 16; i++) { rc_chan[i] = 0; rc_chan_13b[i] = 0; }
     rc_failsafe = false;
+
+#ifdef USE_MAVLINK_SCHEDULER
+    scheduler.Init();
+#endif
+#ifdef USE_MAVLINK_STREAM_TUNING
+    status_serial_in = {};
+    streamtuning.Init();
+    stream_tuning_tlast_ms = millis32();
+    stream_tuning_capacity_bps = 0;
+    stream_tuning_cmd_tlast_ms = 0;
+#endif
 }
 
 
@@ -132,6 +186,9 @@ void MavlinkBase::Do(void)
     uint32_t tnow_ms = millis32();
     bool inject_radio_link_stats = false;
     bool inject_radio_status = false;
+#ifdef USE_MAVLINK_STREAM_TUNING
+    bool inject_message_interval = false;
+#endif
 
     if (!connected()) {
         //Init();
@@ -142,6 +199,9 @@ void MavlinkBase::Do(void)
 
     if (Setup.Rx.SendRadioStatus && connected()) {
         // we currently know that if we determine inject_radio_status here it will be executed immediately
+#ifdef USE_MAVLINK_TXBUF_CONTROLLER
+        inject_radio_status = handle_txbuf_controller(tnow_ms);
+#else
         switch (Setup.Rx.SendRadioStatus) {
         case RX_SEND_RADIO_STATUS_METHOD_ARDUPILOT_1:
             inject_radio_status = handle_txbuf_ardupilot(tnow_ms);
@@ -150,11 +210,24 @@ void MavlinkBase::Do(void)
             inject_radio_status = handle_txbuf_method_b(tnow_ms);
             break;
         }
+#endif
     } else {
         radio_status_tlast_ms = tnow_ms;
         bytes_serial_in_rate_filt.Reset();
+#ifdef USE_MAVLINK_TXBUF_CONTROLLER
+        txbufctrl.Reset();
+#endif
     }
 
+#ifdef USE_MAVLINK_STREAM_TUNING
+    if (connected()) {
+        inject_message_interval = handle_stream_tuning(tnow_ms);
+    } else {
+        stream_tuning_tlast_ms = tnow_ms;
+        streamtuning.Restart();
+    }
+#endif
+
     // TODO: either the buffer must be guaranteed to be large, or we need to check filling
 
     if (inject_rc_channels) { // give it priority // && serial.tx_is_empty()) // check available size!?
@@ -187,6 +260,13 @@ void MavlinkBase::Do(void)
         }
         send_msg_serial_out();
     }
+
+#ifdef USE_MAVLINK_STREAM_TUNING
+    if (inject_message_interval) {
+        generate_message_interval();
+        send_msg_serial_out();
+    }
+#endif
 }
 
 
@@ -196,6 +276,19 @@ typedef enum {
 
 
 void MavlinkBase::putc(char c)
+{
+#ifdef USE_MAVLINK_COMPRESSION
+    // rebuild compressed frames first
+    uint16_t len = unpacker_link_in.Put(c);
+    uint8_t* buf = unpacker_link_in.Buf();
+    for (uint16_t i = 0; i < len; i++) parse_link_in(buf[i]);
+#else
+    parse_link_in(c);
+#endif
+}
+
+
+void MavlinkBase::parse_link_in(char c)
 {
     // parse link in -> serial out
     if (fmav_parse_and_check_to_frame_buf(&result_link_in, buf_link_in, &status_link_in, c)) {
@@ -209,6 +302,7 @@ void MavlinkBase::putc(char c)
         case MODE_50HZ: force_param_list = (Config.SerialBaudrate > 57600); break; // 57600 bps and lower is ok for mftp
         case MODE_31HZ: force_param_list = (Config.SerialBaudrate > 57600); break; // 57600 bps and lower is ok for mftp
         case MODE_19HZ: force_param_list = (Config.SerialBaudrate > 38400); break; // 38400 bps and lower is ok for mftp
+        case MODE_100HZ: force_param_list = (Config.SerialBaudrate > 38400); break; // slim frames, 38400 bps and lower is ok for mftp
         }
         if (force_param_list)
 #endif
@@ -236,7 +330,12 @@ void MavlinkBase::putc(char c)
 
 bool MavlinkBase::available(void)
 {
+#ifdef USE_MAVLINK_SCHEDULER
+    scheduler.Fill(&serial);
+    return scheduler.available();
+#else
     return serial.available();
+#endif
 }
 
 
@@ -245,12 +344,28 @@ uint8_t MavlinkBase::getc(void)
     bytes_serial_in++;
     bytes_serial_in_cnt++;
 
-    return serial.getc();
+#ifdef USE_MAVLINK_SCHEDULER
+    uint8_t c = scheduler.getc();
+#else
+    uint8_t c = serial.getc();
+#endif
+#ifdef USE_MAVLINK_STREAM_TUNING
+    if (fmav_parse_and_check_to_frame_buf(&result_serial_in, buf_serial_in, &status_serial_in, c)) {
+        streamtuning.Put(result_serial_in.sysid, result_serial_in.compid, result_serial_in.msgid, result_serial_in.frame_len);
+    }
+#endif
+    return c;
 }
 
 
 void MavlinkBase::flush(void)
 {
+#ifdef USE_MAVLINK_COMPRESSION
+    unpacker_link_in.Init();
+#endif
+#ifdef USE_MAVLINK_SCHEDULER
+    scheduler.Flush();
+#endif
     serial.flush();
 }
 
@@ -268,9 +383,14 @@ void MavlinkBase::send_msg_serial_out(void)
 //-------------------------------------------------------
 // for the txbuf rate-based mechanism see design_decissions.h for details
 
+// the bytes held back by the scheduler and the packer count too
 uint16_t MavlinkBase::serial_in_available(void)
 {
-    return serial.bytes_available();
+    uint16_t n = serial.bytes_available() + sx_serial_bytes_held();
+#ifdef USE_MAVLINK_SCHEDULER
+    n += scheduler.BytesQueued();
+#endif
+    return n;
 }
 
 
@@ -323,7 +443,7 @@ bool MavlinkBase::handle_txbuf_ardupilot(uint32_t tnow_ms)
 
     // method C, with improvements
     // assumes 1 sec delta time
-    uint32_t rate_max = ((uint32_t)1000 * FRAME_RX_PAYLOAD_LEN) / Config.frame_rate_ms; // theoretical rate, bytes per sec
+    uint32_t rate_max = ((uint32_t)1000 * Config.frame_rx_payload_len) / Config.frame_rate_ms; // theoretical rate, bytes per sec
     uint32_t rate_percentage = (bytes_serial_in * 100) / rate_max;
 
     // https://github.com/ArduPilot/ardupilot/blob/fa6441544639bd5dc84c3e6e3d2f7bfd2aecf96d/libraries/GCS_MAVLink/GCS_Common.cpp#L782-L801
@@ -339,6 +459,9 @@ bool MavlinkBase::handle_txbuf_ardupilot(uint32_t tnow_ms)
     } else {
         txbuf = 50;                       // ArduPilot: 50-90  -> no change, PX4: 35-50  -> no change
     }
+#ifdef USE_MAVLINK_STREAM_TUNING
+    if (streamtuning.autopilot_sysid) txbuf = 50; // the stream rates are tuned by us, only handle bursts
+#endif
 
     if (txbuf_state == TXBUF_STATE_BURST_HIGH) {
         txbuf = 0; // try to slow down as much as possible
@@ -407,7 +530,7 @@ bool MavlinkBase::handle_txbuf_method_b(uint32_t tnow_ms)
                 radio_status_tlast_ms = tnow_ms;
                 inject_radio_status = true;
             } else
-            if (serial_in_available() < FRAME_RX_PAYLOAD_LEN*2) { // less than 2 radio messages remain, back to normal
+            if (serial_in_available() < Config.frame_rx_payload_len*2) { // less than 2 radio messages remain, back to normal
                 txbuf_state = TXBUF_STATE_PX4_RECOVER;
                 radio_status_tlast_ms = tnow_ms;
                 inject_radio_status = true;
@@ -434,7 +557,7 @@ bool MavlinkBase::handle_txbuf_method_b(uint32_t tnow_ms)
 
     // method C, with improvements
     // assumes 1 sec delta time
-    uint32_t rate_max = ((uint32_t)1000 * FRAME_RX_PAYLOAD_LEN) / Config.frame_rate_ms; // theoretical rate, bytes per sec
+    uint32_t rate_max = ((uint32_t)1000 * Config.frame_rx_payload_len) / Config.frame_rate_ms; // theoretical rate, bytes per sec
     uint32_t rate_percentage = (bytes_serial_in * 100) / rate_max;
 
     // https://github.com/ArduPilot/ardupilot/blob/fa6441544639bd5dc84c3e6e3d2f7bfd2aecf96d/libraries/GCS_MAVLink/GCS_Common.cpp#L782-L801
@@ -454,6 +577,9 @@ bool MavlinkBase::handle_txbuf_method_b(uint32_t tnow_ms)
             } else {
                 txbuf = 50;                       // ArduPilot: 50-90  -> no change, PX4: 35-50  -> no change
             }
+#ifdef USE_MAVLINK_STREAM_TUNING
+            if (streamtuning.autopilot_sysid) txbuf = 50; // the stream rates are tuned by us, only handle bursts
+#endif
             break;
 
         case TXBUF_STATE_BURST:
@@ -501,6 +627,41 @@ if(txbuf>50) dbg.puts("*1.025 "); else dbg.puts("*1 ");
 }
 
 
+#ifdef USE_MAVLINK_TXBUF_CONTROLLER
+// see mavlink_txbuf_controller.h for details
+bool MavlinkBase::handle_txbuf_controller(uint32_t tnow_ms)
+{
+    uint32_t capacity_bps = ((uint32_t)1000 * Config.frame_rx_payload_len) / Config.frame_rate_ms;
+    uint16_t queue_len = serial_in_available();
+
+#ifdef USE_MAVLINK_STREAM_TUNING
+    txbufctrl.rate_control = (streamtuning.autopilot_sysid == 0); // the stream rates are tuned by us, only handle the queue
+#endif
+
+    // the rate is of what comes in, so also count what is waiting, the bytes held by the packer are already counted
+    uint32_t bytes_cnt = bytes_serial_in_cnt + queue_len - sx_serial_bytes_held();
+    if (!txbufctrl.Update(tnow_ms, bytes_cnt, queue_len, capacity_bps)) return false;
+
+    switch (Setup.Rx.SendRadioStatus) {
+    case RX_SEND_RADIO_STATUS_METHOD_ARDUPILOT_1:
+        radio_status_txbuf = txbufctrl.TxbufArduPilot();
+        break;
+    case RX_SEND_RADIO_STATUS_METHOD_PX4:
+        radio_status_txbuf = txbufctrl.TxbufPX4();
+        break;
+    }
+/*
+dbg.puts("\nMc: ");
+dbg.puts(u16toBCD_s(txbufctrl.rate_bps));dbg.puts(", ");
+dbg.puts(u16toBCD_s(queue_len));dbg.puts(", ");
+dbg.puts(u16toBCD_s(txbufctrl.delay_ms));dbg.puts(", ");
+dbg.puts(u8toBCD_s(radio_status_txbuf));
+*/
+    return true;
+}
+#endif
+
+
 //-------------------------------------------------------
 // Handle Messages
 //-------------------------------------------------------
@@ -508,6 +669,32 @@ if(txbuf>50) dbg.puts("*1.025 "); else dbg.puts("*1 ");
 // nothing yet
 
 
+#ifdef USE_MAVLINK_STREAM_TUNING
+// see mavlink_stream_tuning.h for details
+bool MavlinkBase::handle_stream_tuning(uint32_t tnow_ms)
+{
+    // link capacity, restart measurement if the mode has changed
+    uint32_t capacity_bps = ((uint32_t)1000 * Config.frame_rx_payload_len) / Config.frame_rate_ms;
+    if (capacity_bps != stream_tuning_capacity_bps) {
+        stream_tuning_capacity_bps = capacity_bps;
+        stream_tuning_tlast_ms = tnow_ms;
+        streamtuning.Restart();
+    }
+
+    if ((tnow_ms - stream_tuning_tlast_ms) >= MAVLINK_STREAM_TUNING_PERIOD_MS) {
+        streamtuning.Update(tnow_ms - stream_tuning_tlast_ms, capacity_bps);
+        stream_tuning_tlast_ms = tnow_ms;
+    }
+
+    // send the changed message intervals one by one, to not burden the serial
+    if ((tnow_ms - stream_tuning_cmd_tlast_ms) < 50) return false;
+    if (!streamtuning.GetCommand(&stream_tuning_msgid, &stream_tuning_interval_us)) return false;
+    stream_tuning_cmd_tlast_ms = tnow_ms;
+    return true;
+}
+#endif
+
+
 //-------------------------------------------------------
 // Generate Messages
 //-------------------------------------------------------
@@ -646,4 +833,20 @@ void MavlinkBase::generate_radio_link_flow_control(void)
 }
 
 
+#ifdef USE_MAVLINK_STREAM_TUNING
+void MavlinkBase::generate_message_interval(void)
+{
+    fmav_msg_command_long_pack(
+        &msg_serial_out,
+        RADIO_LINK_SYSTEM_ID, MAV_COMP_ID_TELEMETRY_RADIO,
+        streamtuning.autopilot_sysid, MAV_COMP_ID_AUTOPILOT1,
+        MAV_CMD_SET_MESSAGE_INTERVAL, 0,
+        stream_tuning_msgid, stream_tuning_interval_us, 0, 0, 0, 0, 0,
+        //uint8_t target_system, uint8_t target_component, uint16_t command, uint8_t confirmation,
+        //float param1, float param2, float param3, float param4, float param5, float param6, float param7,
+        &status_serial_out);
+}
+#endif
+
+
 #endif // MAVLINK_INTERFACE_RX_H
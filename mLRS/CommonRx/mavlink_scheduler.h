@@ -0,0 +1,317 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// MAVLink Scheduler for Receiver
+//********************************************************
+#ifndef MAVLINK_SCHEDULER_H
+#define MAVLINK_SCHEDULER_H
+#pragma once
+
+
+#include <inttypes.h>
+#include <string.h>
+
+
+//-------------------------------------------------------
+// MAVLink Scheduler
+//-------------------------------------------------------
+// sits between the serial from the flight controller and the link, and hands out whole messages by priority
+// - high: heartbeat, statustext, command ack
+// - normal: telemetry streams and all messages not listed otherwise
+// - bulk: params, missions, ftp, logs, these are never dropped and keep their order
+// for the common single-instance telemetry streams the latest value wins, i.e. a sample which is still
+// queued is replaced by a new sample of the same stream, so stale samples are dropped instead of queued
+// if no bulk message was send for MAVLINK_SCHED_BULK_TMO_MS, the oldest bulk message goes next before all others,
+// so that bulk transfers can't starve
+// if the scheduler is full, it doesn't read from serial, the txbuf mechanism is then expected to slow down
+// the flight controller, since serial_in_available() includes the bytes in the scheduler
+// bytes which are not part of a MAVLink frame are passed on as bulk, the data stream is otherwise not
+// changed except for the order and the dropped samples
+
+#define MAVLINK_SCHED_BUF_SIZE        2048
+#define MAVLINK_SCHED_NUM             48 // max number of queued messages
+#define MAVLINK_SCHED_FRAME_LEN_MAX   280 // max length of a MAVLink frame
+#define MAVLINK_SCHED_BULK_TMO_MS     100
+#define MAVLINK_SCHED_STAGE_TMO_MS    100 // an incomplete frame is passed on as raw bytes after this time
+
+typedef enum {
+    MAVLINK_SCHED_PRIO_HIGH = 0,
+    MAVLINK_SCHED_PRIO_NORMAL,
+    MAVLINK_SCHED_PRIO_BULK,
+} MAVLINK_SCHED_PRIO_ENUM;
+
+#define MAVLINK_SCHED_MSGID_RAW       UINT32_MAX // for bytes which are not part of a frame
+
+
+class tMavlinkScheduler
+{
+  public:
+    void Init(void)
+    {
+        Flush();
+        dropped_cnt = 0;
+    }
+
+    void Flush(void)
+    {
+        buf_len = 0;
+        stage_len = 0;
+        stage_msg_len = 0;
+        num = 0;
+        out_i = UINT8_MAX;
+        out_pos = 0;
+        bulk_tlast_ms = millis32();
+    }
+
+    // reads from serial as long as there is room for a complete frame
+    void Fill(tSerialBase* serial)
+    {
+        while (serial->available()) {
+            if (!stage_len && ((buf_len + MAVLINK_SCHED_FRAME_LEN_MAX > MAVLINK_SCHED_BUF_SIZE) || (num >= MAVLINK_SCHED_NUM))) {
+                return; // no room for another message
+            }
+
+            uint8_t c = serial->getc();
+            uint8_t* stage = buf + buf_len;
+            stage[stage_len++] = c;
+
+            if (stage_len == 1) {
+                if ((c != 0xFD) && (c != 0xFE)) { // not a v2 or v1 magic, pass it on
+                    add_raw();
+                    continue;
+                }
+                stage_tstart_ms = millis32();
+            } else
+            if ((stage_len == 2) && (stage[0] == 0xFE)) {
+                stage_msg_len = 8 + c; // v1: header 6 + payload + crc 2
+            } else
+            if ((stage_len == 3) && (stage[0] == 0xFD)) {
+                stage_msg_len = 12 + stage[1] + ((c & 0x01) ? 13 : 0); // v2: header 10 + payload + crc 2 + signature 13 if signed
+            }
+
+            if (stage_msg_len && (stage_len >= stage_msg_len)) add_msg();
+        }
+
+        if (stage_len && ((millis32() - stage_tstart_ms) > MAVLINK_SCHED_STAGE_TMO_MS)) {
+            add_entry(MAVLINK_SCHED_MSGID_RAW, 0, 0, MAVLINK_SCHED_PRIO_BULK); // don't hold it back any longer
+            buf_len += stage_len;
+            stage_len = stage_msg_len = 0;
+        }
+    }
+
+    bool available(void)
+    {
+        if (out_i == UINT8_MAX) out_i = pick();
+        return (out_i != UINT8_MAX);
+    }
+
+    uint8_t getc(void)
+    {
+        if (!available()) return 0; // should not happen
+
+        uint8_t c = buf[entry[out_i].offset + out_pos];
+        out_pos++;
+        if (out_pos >= entry[out_i].len) {
+            remove(out_i);
+            out_i = UINT8_MAX;
+            out_pos = 0;
+        }
+        return c;
+    }
+
+    uint16_t BytesQueued(void)
+    {
+        return buf_len + stage_len - out_pos;
+    }
+
+    uint32_t dropped_cnt; // number of stale samples which were dropped
+
+  private:
+    void add_raw(void)
+    {
+        // append to the previous entry if it is raw too, but not if it's currently handed out
+        if (num && (entry[num - 1].msgid == MAVLINK_SCHED_MSGID_RAW) && (out_i != num - 1)) {
+            entry[num - 1].len++;
+        } else {
+            add_entry(MAVLINK_SCHED_MSGID_RAW, 0, 0, MAVLINK_SCHED_PRIO_BULK);
+        }
+        buf_len++;
+        stage_len = 0;
+    }
+
+    void add_msg(void)
+    {
+        uint8_t* stage = buf + buf_len;
+        uint32_t msgid;
+        uint8_t sysid, compid;
+        if (stage[0] == 0xFD) {
+            sysid = stage[5];
+            compid = stage[6];
+            msgid = stage[7] + ((uint32_t)stage[8] << 8) + ((uint32_t)stage[9] << 16);
+        } else {
+            sysid = stage[3];
+            compid = stage[4];
+            msgid = stage[5];
+        }
+        uint8_t prio = msg_prio(msgid);
+
+        if (latest_value_wins(msgid)) {
+            for (uint8_t i = 0; i < num; i++) {
+                if (i == out_i) continue; // is being handed out
+                if (entry[i].msgid != msgid || entry[i].sysid != sysid || entry[i].compid != compid) continue;
+                dropped_cnt++;
+                if (entry[i].len == stage_len) { // replace it in place, it keeps its position in the queue
+                    memcpy(buf + entry[i].offset, stage, stage_len);
+                    stage_len = stage_msg_len = 0;
+                    return;
+                }
+                remove(i); // this also moves the stage
+                break;
+            }
+        }
+
+        add_entry(msgid, sysid, compid, prio);
+        buf_len += stage_len;
+        stage_len = stage_msg_len = 0;
+    }
+
+    void add_entry(uint32_t msgid, uint8_t sysid, uint8_t compid, uint8_t prio)
+    {
+        entry[num].offset = buf_len;
+        entry[num].len = stage_len;
+        entry[num].msgid = msgid;
+        entry[num].sysid = sysid;
+        entry[num].compid = compid;
+        entry[num].prio = prio;
+        num++;
+    }
+
+    void remove(uint8_t i)
+    {
+        uint16_t offset = entry[i].offset;
+        uint16_t len = entry[i].len;
+
+        memmove(buf + offset, buf + offset + len, buf_len + stage_len - offset - len);
+        buf_len -= len;
+
+        for (uint8_t n = i; n < num - 1; n++) {
+            entry[n] = entry[n + 1];
+            entry[n].offset -= len;
+        }
+        num--;
+        if ((out_i != UINT8_MAX) && (out_i > i)) out_i--;
+    }
+
+    // the first message of the highest priority, the oldest bulk message goes first if bulk had to wait for too long
+    uint8_t pick(void)
+    {
+        uint8_t i_pick = UINT8_MAX;
+        uint8_t i_bulk = UINT8_MAX;
+        uint32_t tnow_ms = millis32();
+
+        for (uint8_t i = 0; i < num; i++) {
+            if ((i_bulk == UINT8_MAX) && (entry[i].prio == MAVLINK_SCHED_PRIO_BULK)) i_bulk = i;
+            if ((i_pick == UINT8_MAX) || (entry[i].prio < entry[i_pick].prio)) i_pick = i;
+        }
+
+        if ((i_bulk != UINT8_MAX) && ((tnow_ms - bulk_tlast_ms) > MAVLINK_SCHED_BULK_TMO_MS)) i_pick = i_bulk;
+        if ((i_bulk == UINT8_MAX) || (i_pick == i_bulk)) bulk_tlast_ms = tnow_ms; // no bulk message is waiting
+        return i_pick;
+    }
+
+    uint8_t msg_prio(uint32_t msgid)
+    {
+        switch (msgid) {
+        case FASTMAVLINK_MSG_ID_HEARTBEAT:
+        case FASTMAVLINK_MSG_ID_STATUSTEXT:
+        case FASTMAVLINK_MSG_ID_COMMAND_ACK:
+            return MAVLINK_SCHED_PRIO_HIGH;
+
+        case FASTMAVLINK_MSG_ID_PARAM_VALUE:
+        case FASTMAVLINK_MSG_ID_MISSION_ITEM:
+        case FASTMAVLINK_MSG_ID_MISSION_REQUEST:
+        case FASTMAVLINK_MSG_ID_MISSION_COUNT:
+        case FASTMAVLINK_MSG_ID_MISSION_ACK:
+        case FASTMAVLINK_MSG_ID_MISSION_REQUEST_INT:
+        case FASTMAVLINK_MSG_ID_MISSION_ITEM_INT:
+        case FASTMAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL:
+        case FASTMAVLINK_MSG_ID_LOG_ENTRY:
+        case FASTMAVLINK_MSG_ID_LOG_DATA:
+        case FASTMAVLINK_MSG_ID_REMOTE_LOG_DATA_BLOCK:
+        case FASTMAVLINK_MSG_ID_SERIAL_CONTROL:
+        case FASTMAVLINK_MSG_ID_DATA_TRANSMISSION_HANDSHAKE:
+        case FASTMAVLINK_MSG_ID_ENCAPSULATED_DATA:
+        case FASTMAVLINK_MSG_ID_FENCE_POINT:
+        case FASTMAVLINK_MSG_ID_RALLY_POINT:
+            return MAVLINK_SCHED_PRIO_BULK;
+        }
+        return MAVLINK_SCHED_PRIO_NORMAL;
+    }
+
+    // streams which are known to have only one instance per component
+    bool latest_value_wins(uint32_t msgid)
+    {
+        switch (msgid) {
+        case FASTMAVLINK_MSG_ID_SYS_STATUS:
+        case FASTMAVLINK_MSG_ID_SYSTEM_TIME:
+        case FASTMAVLINK_MSG_ID_GPS_RAW_INT:
+        case FASTMAVLINK_MSG_ID_RAW_IMU:
+        case FASTMAVLINK_MSG_ID_SCALED_PRESSURE:
+        case FASTMAVLINK_MSG_ID_ATTITUDE:
+        case FASTMAVLINK_MSG_ID_ATTITUDE_QUATERNION:
+        case FASTMAVLINK_MSG_ID_LOCAL_POSITION_NED:
+        case FASTMAVLINK_MSG_ID_GLOBAL_POSITION_INT:
+        case FASTMAVLINK_MSG_ID_RC_CHANNELS_RAW:
+        case FASTMAVLINK_MSG_ID_MISSION_CURRENT:
+        case FASTMAVLINK_MSG_ID_NAV_CONTROLLER_OUTPUT:
+        case FASTMAVLINK_MSG_ID_RC_CHANNELS:
+        case FASTMAVLINK_MSG_ID_VFR_HUD:
+        case FASTMAVLINK_MSG_ID_SCALED_IMU2:
+        case FASTMAVLINK_MSG_ID_GPS2_RAW:
+        case FASTMAVLINK_MSG_ID_POWER_STATUS:
+        case FASTMAVLINK_MSG_ID_SCALED_IMU3:
+        case FASTMAVLINK_MSG_ID_TERRAIN_REPORT:
+        case FASTMAVLINK_MSG_ID_SCALED_PRESSURE2:
+        case FASTMAVLINK_MSG_ID_ALTITUDE:
+        case FASTMAVLINK_MSG_ID_MEMINFO:
+        case FASTMAVLINK_MSG_ID_AHRS:
+        case FASTMAVLINK_MSG_ID_HWSTATUS:
+        case FASTMAVLINK_MSG_ID_WIND:
+        case FASTMAVLINK_MSG_ID_RANGEFINDER:
+        case FASTMAVLINK_MSG_ID_AHRS2:
+        case FASTMAVLINK_MSG_ID_EKF_STATUS_REPORT:
+        case FASTMAVLINK_MSG_ID_ESTIMATOR_STATUS:
+        case FASTMAVLINK_MSG_ID_VIBRATION:
+        case FASTMAVLINK_MSG_ID_HOME_POSITION:
+        case FASTMAVLINK_MSG_ID_EXTENDED_SYS_STATE:
+            return true;
+        }
+        return false;
+    }
+
+    uint8_t buf[MAVLINK_SCHED_BUF_SIZE]; // queued messages, followed by the message currently being received
+    uint16_t buf_len; // bytes of the queued messages
+    uint16_t stage_len; // bytes of the message currently being received
+    uint16_t stage_msg_len; // its length, 0 if not yet known
+    uint32_t stage_tstart_ms;
+
+    struct {
+        uint16_t offset;
+        uint16_t len;
+        uint32_t msgid;
+        uint8_t sysid;
+        uint8_t compid;
+        uint8_t prio;
+    } entry[MAVLINK_SCHED_NUM]; // in order of arrival
+    uint8_t num;
+
+    uint8_t out_i; // entry which is currently handed out, UINT8_MAX if none
+    uint16_t out_pos;
+    uint32_t bulk_tlast_ms;
+};
+
+
+#endif // MAVLINK_SCHEDULER_H
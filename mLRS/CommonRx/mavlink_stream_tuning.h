@@ -0,0 +1,236 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// MAVLink Stream Rate Tuning for Receiver
+//********************************************************
+#ifndef MAVLINK_STREAM_TUNING_H
+#define MAVLINK_STREAM_TUNING_H
+#pragma once
+
+
+#include <inttypes.h>
+
+
+//-------------------------------------------------------
+// MAVLink Stream Rate Tuning
+//-------------------------------------------------------
+// the Rx measures the byte rate of each message stream of the autopilot in the serial in stream, and sets
+// the message intervals with MAV_CMD_SET_MESSAGE_INTERVAL such that the telemetry fits into the link capacity
+// - the link capacity is frame_rx_payload_len * frame rate, less MAVLINK_STREAM_TUNING_HEADROOM_PCT
+// - messages which are not streams, like params, missions, ftp, statustext, are not tuned, their bursts
+//   are covered by the headroom and the txbuf mechanism
+// - messages of other components are not tuned, but their bytes are taken off the capacity
+// - streams are scaled by a common factor, so the ratios between the streams set by the GCS are kept
+// - the streams are aimed at 90% of the capacity, nothing is done as long as they are within 80%..100%
+// - streams are never made faster than they were before they were tuned, nor slower than 0.5 Hz
+// - when the link mode changes the measurement is restarted, so the streams are re-tuned to the new mode
+// REQUEST_DATA_STREAM is not used, since it only works on groups of streams
+
+#ifndef MAVLINK_STREAM_TUNING_HEADROOM_PCT
+  #define MAVLINK_STREAM_TUNING_HEADROOM_PCT  20 // capacity which is kept free, for bursts and non-stream messages
+#endif
+#define MAVLINK_STREAM_TUNING_NUM             24 // max number of tracked streams
+#define MAVLINK_STREAM_TUNING_PERIOD_MS       2000 // measurement period
+#define MAVLINK_STREAM_TUNING_RATE_MIN_MHZ    500 // streams are not made slower than this
+#define MAVLINK_STREAM_TUNING_TARGET_PCT      90
+#define MAVLINK_STREAM_TUNING_LOW_PCT         80
+
+
+class tMavlinkStreamTuning
+{
+  public:
+    void Init(void)
+    {
+        autopilot_sysid = 0;
+        for (uint8_t i = 0; i < MAVLINK_STREAM_TUNING_NUM; i++) stream[i].used = false;
+        Restart();
+    }
+
+    // starts a new measurement period, the tuning of the streams is kept
+    void Restart(void)
+    {
+        for (uint8_t i = 0; i < MAVLINK_STREAM_TUNING_NUM; i++) {
+            stream[i].cnt = 0;
+            stream[i].bytes = 0;
+        }
+        other_bytes = 0;
+    }
+
+    // called for each message in the serial in stream
+    void Put(uint8_t sysid, uint8_t compid, uint32_t msgid, uint16_t len)
+    {
+        if (msgid == FASTMAVLINK_MSG_ID_HEARTBEAT && compid == MAV_COMP_ID_AUTOPILOT1) {
+            autopilot_sysid = sysid;
+        }
+
+        if (!autopilot_sysid || sysid != autopilot_sysid || compid != MAV_COMP_ID_AUTOPILOT1) {
+            other_bytes += len;
+            return;
+        }
+        if (!is_stream(msgid)) return;
+
+        uint8_t i = find(msgid);
+        if (i >= MAVLINK_STREAM_TUNING_NUM) { other_bytes += len; return; } // table is full
+
+        stream[i].cnt++;
+        stream[i].bytes += len;
+    }
+
+    // called at the end of a measurement period, capacity_bps is the link capacity in bytes per sec
+    void Update(uint32_t period_ms, uint32_t capacity_bps)
+    {
+        uint32_t budget_bps = (capacity_bps * (100 - MAVLINK_STREAM_TUNING_HEADROOM_PCT)) / 100;
+        uint32_t other_bps = (other_bytes * 1000) / period_ms;
+        uint32_t stream_bps = 0;
+        bool tuned = false;
+
+        for (uint8_t i = 0; i < MAVLINK_STREAM_TUNING_NUM; i++) {
+            if (!stream[i].used) continue;
+            if (!stream[i].cnt) {
+                // is gone, we keep tuned streams for some periods, since slow streams may miss a period
+                if (!stream[i].tuned || ++stream[i].missed >= 3) stream[i].used = false;
+            } else {
+                stream[i].missed = 0;
+            }
+            stream[i].rate_mhz = ((uint32_t)stream[i].cnt * 1000000) / period_ms;
+            stream[i].bps = (stream[i].bytes * 1000) / period_ms;
+            stream_bps += stream[i].bps;
+            if (stream[i].tuned) tuned = true;
+        }
+        Restart();
+
+        if (!stream_bps) return;
+
+        budget_bps = (budget_bps > other_bps) ? budget_bps - other_bps : 0;
+
+        if (stream_bps <= budget_bps && (stream_bps >= (budget_bps * MAVLINK_STREAM_TUNING_LOW_PCT) / 100 || !tuned)) {
+            return; // is fine
+        }
+
+        // the factor by which the streams are scaled, in percent
+        // when going down all streams are scaled, when going up only those which were tuned
+        bool up = (stream_bps < budget_bps);
+        uint32_t scaled_bps = 0;
+        for (uint8_t i = 0; i < MAVLINK_STREAM_TUNING_NUM; i++) {
+            if (stream[i].used && (!up || stream[i].tuned)) scaled_bps += stream[i].bps;
+        }
+        if (!scaled_bps) return;
+
+        uint32_t target_bps = (budget_bps * MAVLINK_STREAM_TUNING_TARGET_PCT) / 100;
+        uint32_t fixed_bps = stream_bps - scaled_bps;
+        uint32_t factor_pct = (target_bps > fixed_bps) ? ((target_bps - fixed_bps) * 100) / scaled_bps : 0;
+        if (factor_pct > 200) factor_pct = 200; // don't go up too fast, the measurement may be off
+
+        for (uint8_t i = 0; i < MAVLINK_STREAM_TUNING_NUM; i++) {
+            if (!stream[i].used || !stream[i].rate_mhz) continue;
+
+            if (!stream[i].tuned) {
+                if (factor_pct >= 100) continue;
+                // remember the rate as it was set by the GCS, rates above 1 Hz are typically integer
+                stream[i].rate_base_mhz = stream[i].rate_mhz;
+                if (stream[i].rate_mhz >= 1500) stream[i].rate_base_mhz = ((stream[i].rate_mhz + 500) / 1000) * 1000;
+                stream[i].rate_set_mhz = stream[i].rate_base_mhz;
+                stream[i].tuned = true;
+            }
+
+            // scale what we have set, the measured rate is too noisy
+            uint32_t rate_mhz = (stream[i].rate_set_mhz * factor_pct) / 100;
+            uint32_t rate_min_mhz = (stream[i].rate_base_mhz < MAVLINK_STREAM_TUNING_RATE_MIN_MHZ) ?
+                                        stream[i].rate_base_mhz : MAVLINK_STREAM_TUNING_RATE_MIN_MHZ;
+            if (rate_mhz < rate_min_mhz) rate_mhz = rate_min_mhz;
+            if (rate_mhz >= stream[i].rate_base_mhz) {
+                rate_mhz = stream[i].rate_base_mhz;
+                stream[i].tuned = false; // is back to where it was
+            }
+            if (rate_mhz == stream[i].rate_set_mhz && stream[i].tuned) continue;
+
+            stream[i].rate_set_mhz = rate_mhz;
+            stream[i].pending = true;
+        }
+    }
+
+    // returns true if a message interval needs to be send
+    bool GetCommand(uint32_t* msgid, float* interval_us)
+    {
+        for (uint8_t i = 0; i < MAVLINK_STREAM_TUNING_NUM; i++) {
+            if (!stream[i].used || !stream[i].pending) continue;
+            stream[i].pending = false;
+            *msgid = stream[i].msgid;
+            *interval_us = 1.0E9f / stream[i].rate_set_mhz;
+            return true;
+        }
+        return false;
+    }
+
+    uint8_t autopilot_sysid;
+
+  private:
+    bool is_stream(uint32_t msgid)
+    {
+        switch (msgid) {
+        case FASTMAVLINK_MSG_ID_HEARTBEAT:
+        case FASTMAVLINK_MSG_ID_PARAM_VALUE:
+        case FASTMAVLINK_MSG_ID_MISSION_ITEM:
+        case FASTMAVLINK_MSG_ID_MISSION_REQUEST:
+        case FASTMAVLINK_MSG_ID_MISSION_COUNT:
+        case FASTMAVLINK_MSG_ID_MISSION_ACK:
+        case FASTMAVLINK_MSG_ID_MISSION_REQUEST_INT:
+        case FASTMAVLINK_MSG_ID_MISSION_ITEM_INT:
+        case FASTMAVLINK_MSG_ID_COMMAND_ACK:
+        case FASTMAVLINK_MSG_ID_RADIO_STATUS:
+        case FASTMAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL:
+        case FASTMAVLINK_MSG_ID_TIMESYNC:
+        case FASTMAVLINK_MSG_ID_LOG_ENTRY:
+        case FASTMAVLINK_MSG_ID_LOG_DATA:
+        case FASTMAVLINK_MSG_ID_AUTOPILOT_VERSION:
+        case FASTMAVLINK_MSG_ID_STATUSTEXT:
+        case FASTMAVLINK_MSG_ID_MESSAGE_INTERVAL:
+            return false;
+        }
+        return true;
+    }
+
+    // returns the index of the stream, adds it if not yet in the list
+    uint8_t find(uint32_t msgid)
+    {
+        uint8_t i_free = MAVLINK_STREAM_TUNING_NUM;
+        for (uint8_t i = 0; i < MAVLINK_STREAM_TUNING_NUM; i++) {
+            if (!stream[i].used) {
+                if (i_free >= MAVLINK_STREAM_TUNING_NUM) i_free = i;
+                continue;
+            }
+            if (stream[i].msgid == msgid) return i;
+        }
+        if (i_free < MAVLINK_STREAM_TUNING_NUM) {
+            stream[i_free].used = true;
+            stream[i_free].msgid = msgid;
+            stream[i_free].cnt = 0;
+            stream[i_free].bytes = 0;
+            stream[i_free].missed = 0;
+            stream[i_free].tuned = false;
+            stream[i_free].pending = false;
+        }
+        return i_free;
+    }
+
+    struct {
+        bool used;
+        uint32_t msgid;
+        uint16_t cnt; // messages in this period
+        uint32_t bytes; // bytes in this period
+        uint32_t rate_mhz; // measured rate of last period
+        uint32_t bps; // measured bytes per sec of last period
+        uint8_t missed; // periods without message
+        bool tuned;
+        uint32_t rate_base_mhz; // rate before it was tuned
+        uint32_t rate_set_mhz; // rate we have set
+        bool pending; // needs to be send
+    } stream[MAVLINK_STREAM_TUNING_NUM];
+    uint32_t other_bytes;
+};
+
+
+#endif // MAVLINK_STREAM_TUNING_H
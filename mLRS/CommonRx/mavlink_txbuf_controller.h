@@ -0,0 +1,161 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// MAVLink txbuf Controller for Receiver
+//********************************************************
+#ifndef MAVLINK_TXBUF_CONTROLLER_H
+#define MAVLINK_TXBUF_CONTROLLER_H
+#pragma once
+
+
+#include <inttypes.h>
+#include "../Common/libs/filters.h"
+
+
+//-------------------------------------------------------
+// MAVLink txbuf Controller
+//-------------------------------------------------------
+// replaces the txbuf state machines by a controller, which works on the rate and the queue depth
+// - the rate is the filtered rate of bytes coming in from the serial, it also counts the bytes still waiting
+// - the queue depth is the bytes waiting in the serial rx buffer, it is converted to the delay it causes,
+//   so that the settings work for all modes
+// - the queue is the integral of the input rate minus the link capacity, it thus provides the I term,
+//   and there is no integrator which could wind up
+//   u = (rate - target rate) / capacity + (delay - target delay) / drain time
+// - u is mapped to the txbuf bands of ArduPilot and PX4, with a dead band around zero
+//   ArduPilot: 0-19 -> +60 ms, 20-49 -> +20 ms, 50-90 -> no change, 91-95 -> -20 ms, 96-100 -> -40 ms
+//   PX4:       0-24 -> *0.8, 25-34 -> *0.975, 35-50 -> no change, 51-100 -> *1.025
+// - params are cut when the delay is large, ArduPilot sends params only if txbuf > 50, the cut is send
+//   immediately, since a param burst can fill the buffer within one period
+// - RADIO_STATUS is sent with a fixed rate, the autopilots effectively integrate the txbuf steps,
+//   so the rate determines the loop gain
+// - the autopilots' steps don't scale with the link capacity, so at low capacity, i.e. 19 Hz mode, the loop
+//   gain is too high and the rate is noisier, the rate filter is then made slower and the weak dead band wider
+// - the rate term is used only once the rate filter has settled, else it would raise the rates at startup
+// the simulation tools/run_txbuf_simulation.py mirrors this controller, and was used to find the settings
+
+#define TXBUF_CTRL_PERIOD_MS          250 // RADIO_STATUS rate, 4 Hz
+#define TXBUF_CTRL_PERIOD_MIN_MS      50 // min time between RADIO_STATUS, for cutting params
+#define TXBUF_CTRL_RATE_T_MS          1000 // time constant of the rate filter
+#define TXBUF_CTRL_RATE_TARGET_PCT    85
+#define TXBUF_CTRL_DELAY_TARGET_MS    200
+#define TXBUF_CTRL_DRAIN_MS           1000 // the excess queue should be drained in this time
+#define TXBUF_CTRL_DELAY_PARAMS_MS    300 // params are cut above this delay
+#define TXBUF_CTRL_U_WEAK_PM          100 // dead band, in permille of capacity
+#define TXBUF_CTRL_U_STRONG_PM        300
+#define TXBUF_CTRL_CAPACITY_REF_BPS   5000 // below this capacity the rate filter and weak dead band are scaled up
+
+
+class tTxbufController
+{
+  public:
+    void Init(void)
+    {
+        rate_control = true;
+        Reset();
+    }
+
+    void Reset(void)
+    {
+        tlast_ms = 0;
+        rate_filt.Reset();
+        rate_bps = 0;
+        delay_ms = 0;
+        u_pm = 0;
+        level = 0;
+        params_cut = false;
+    }
+
+    // called each loop, bytes_cnt is the running count of bytes received from the serial, queue_len the bytes
+    // waiting, capacity_bps the link capacity in bytes per sec
+    // returns true if a RADIO_STATUS is due
+    bool Update(uint32_t tnow_ms, uint32_t bytes_cnt, uint32_t queue_len, uint32_t capacity_bps)
+    {
+        if (!capacity_bps) return false;
+
+        delay_ms = (queue_len * 1000) / capacity_bps;
+
+        if ((tnow_ms - tlast_ms) < TXBUF_CTRL_PERIOD_MS) {
+            // cut params immediately when the queue builds up
+            if (!params_cut && delay_ms > TXBUF_CTRL_DELAY_PARAMS_MS && (tnow_ms - tlast_ms) >= TXBUF_CTRL_PERIOD_MIN_MS) {
+                params_cut = true;
+                level = 0; // only cut the params, the streams are handled with the next period
+                return true;
+            }
+            return false;
+        }
+        tlast_ms = tnow_ms;
+
+        uint32_t scale_pm = (TXBUF_CTRL_CAPACITY_REF_BPS * 1000) / capacity_bps;
+        if (scale_pm < 1000) scale_pm = 1000;
+
+        rate_filt.Update(tnow_ms, bytes_cnt, (TXBUF_CTRL_RATE_T_MS * scale_pm) / 1000);
+        rate_bps = rate_filt.Get();
+
+        int32_t rate_err_pm = 0;
+        if (rate_control && (rate_filt.state > 1)) { // the filter has settled
+            rate_err_pm = ((rate_bps - (int32_t)(capacity_bps * TXBUF_CTRL_RATE_TARGET_PCT) / 100) * 1000) / (int32_t)capacity_bps;
+        }
+        int32_t delay_err_ms = delay_ms - TXBUF_CTRL_DELAY_TARGET_MS;
+        if (delay_err_ms < 0) delay_err_ms = 0; // the queue can't be negative, an empty queue says nothing
+
+        u_pm = rate_err_pm + (delay_err_ms * 1000) / TXBUF_CTRL_DRAIN_MS;
+
+        int32_t u_weak_pm = (TXBUF_CTRL_U_WEAK_PM * scale_pm) / 1000;
+        if (u_weak_pm > TXBUF_CTRL_U_STRONG_PM) u_weak_pm = TXBUF_CTRL_U_STRONG_PM;
+
+        if (u_pm > TXBUF_CTRL_U_STRONG_PM) {
+            level = 2;
+        } else if (u_pm > u_weak_pm) {
+            level = 1;
+        } else if (u_pm < -TXBUF_CTRL_U_STRONG_PM) {
+            level = -2;
+        } else if (u_pm < -u_weak_pm) {
+            level = -1;
+        } else {
+            level = 0;
+        }
+        params_cut = (delay_ms > TXBUF_CTRL_DELAY_PARAMS_MS);
+
+        return true;
+    }
+
+    uint8_t TxbufArduPilot(void)
+    {
+        switch (level) {
+        case 2: return 0; // +60 ms
+        case 1: return 30; // +20 ms
+        case -1: return 91; // -20 ms
+        case -2: return 100; // -40 ms
+        }
+        return (params_cut) ? 50 : 60; // no change
+    }
+
+    uint8_t TxbufPX4(void)
+    {
+        switch (level) {
+        case 2: return 0; // *0.8
+        case 1: return 30; // *0.975
+        case -1: case -2: return 100; // *1.025
+        }
+        return (params_cut) ? 33 : 40; // 40: no change, 33: *0.975 but just enough to stop parameter flow
+    }
+
+    bool rate_control; // false if the stream rates are set otherwise, e.g. by stream tuning
+
+    int32_t rate_bps;
+    int32_t delay_ms;
+    int32_t u_pm;
+
+  private:
+    uint32_t tlast_ms;
+    LPFilterRate rate_filt;
+    int8_t level;
+    bool params_cut;
+};
+
+
+#endif // MAVLINK_TXBUF_CONTROLLER_H
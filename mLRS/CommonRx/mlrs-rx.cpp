@@ -170,6 +170,11 @@ MavlinkBase mavlink;
 
 tRxSxSerial sx_serial;
 
+static inline uint16_t sx_serial_bytes_held(void)
+{
+  return sx_serial.bytes_held();
+}
+
 
 //-------------------------------------------------------
 // Init
@@ -207,10 +212,13 @@ void init(void)
 
 volatile uint16_t irq_status;
 volatile uint16_t irq2_status;
+volatile uint32_t irq_rx_done_10us; // time stamp of the dio edge, is taken first thing in the isr
+volatile uint32_t irq2_rx_done_10us;
 
 IRQHANDLER(
 void SX_DIO_EXTI_IRQHandler(void)
 {
+    irq_rx_done_10us = CLOCK_TIMx->CNT;
     sx_dio_exti_isr_clearflag();
     irq_status = sx.GetAndClearIrqStatus(SX12xx_IRQ_ALL);
     if (irq_status & SX12xx_IRQ_RX_DONE) {
@@ -229,6 +237,7 @@ void SX_DIO_EXTI_IRQHandler(void)
 IRQHANDLER(
 void SX2_DIO_EXTI_IRQHandler(void)
 {
+    irq2_rx_done_10us = CLOCK_TIMx->CNT;
     sx2_dio_exti_isr_clearflag();
     irq2_status = sx2.GetAndClearIrqStatus(SX12xx_IRQ_ALL);
     if (irq2_status & SX12xx_IRQ_RX_DONE) {
@@ -255,6 +264,15 @@ uint8_t link_rx2_status;
 uint8_t link_task;
 uint8_t transmit_frame_type;
 bool doParamsStore;
+bool doParamsStoreEEPROM;
+bool params_store_done;
+uint8_t fhss_swap_i;
+uint8_t fhss_swap_ch;
+int8_t rx_power_reported_dbm;
+uint8_t mode_switch_mode;
+uint8_t mode_switch_cnt;
+bool mode_switch_confirmed;
+bool doModeSwitch;
 
 
 void link_task_init(void)
@@ -263,6 +281,8 @@ void link_task_init(void)
     transmit_frame_type = TRANSMIT_FRAME_TYPE_NORMAL;
 
     doParamsStore = false;
+    doParamsStoreEEPROM = false;
+    params_store_done = false;
 }
 
 
@@ -290,21 +310,42 @@ tCmdFrameHeader* head = (tCmdFrameHeader*)(frame->payload);
     case FRAME_CMD_GET_RX_SETUPDATA:
         // request to send setup data, trigger sending RX_SETUPDATA in next transmission
         link_task_set(LINK_TASK_RX_SEND_RX_SETUPDATA);
+        fhss.ResetSwaps(); // the Tx resets its list on receiving RX_SETUPDATA
         break;
     case FRAME_CMD_SET_RX_PARAMS:
         // received rx params, trigger sending RX_SETUPDATA in next transmission
         unpack_txcmdframe_setrxparams(frame);
         link_task_set(LINK_TASK_RX_SEND_RX_SETUPDATA);
+        fhss.ResetSwaps();
         break;
     case FRAME_CMD_STORE_RX_PARAMS:
         // got request to store rx params
-        doParamsStore = true;
+        // the Tx repeats the cmd for a while, so we store only once if it is done without restart
+        if (!params_store_done) doParamsStore = true;
         break;
     case FRAME_CMD_GET_RX_SETUPDATA_WRELOAD:
         setup_reload();
         // request to send setup data, trigger sending RX_SETUPDATA in next transmission
         link_task_set(LINK_TASK_RX_SEND_RX_SETUPDATA);
+        fhss.ResetSwaps();
         break;
+    case FRAME_CMD_FHSS_SWAP: {
+        // schedule the channel swap, trigger sending FHSS_SWAP_ACK in next transmission
+        tCmdFrameFhssSwap* fhss_swap = (tCmdFrameFhssSwap*)(frame->payload);
+        fhss_swap_i = fhss_swap->fhss_i;
+        fhss_swap_ch = fhss_swap->ch;
+        fhss.SetChannelSwap(fhss_swap_i, fhss_swap_ch);
+        link_task_set(LINK_TASK_RX_SEND_FHSS_SWAP_ACK);
+        }break;
+    case FRAME_CMD_MODE_SWITCH: {
+        // schedule the switch, the Tx repeats it with cnt counting down
+        // we switch only if it is confirmed, i.e. the Tx got our ack, else trigger sending MODE_SWITCH_ACK
+        tCmdFrameModeSwitch* mode_switch = (tCmdFrameModeSwitch*)(frame->payload);
+        mode_switch_mode = mode_switch->mode;
+        mode_switch_cnt = mode_switch->cnt;
+        mode_switch_confirmed = (mode_switch->confirmed != 0);
+        if (!mode_switch_confirmed) link_task_set(LINK_TASK_RX_SEND_MODE_SWITCH_ACK);
+        }break;
     }
 }
 
@@ -315,11 +356,68 @@ void pack_rxcmdframe(tRxFrame* frame, tFrameStats* frame_stats)
     case LINK_TASK_RX_SEND_RX_SETUPDATA:
         // send rx setup data
         pack_rxcmdframe_rxsetupdata(frame, frame_stats);
+        rx_power_reported_dbm = sx.RfPower_dbm();
         break;
+    case LINK_TASK_RX_SEND_FHSS_SWAP_ACK:
+        pack_rxcmdframe_fhssswapack(frame, frame_stats, fhss_swap_i, fhss_swap_ch);
+        break;
+    case LINK_TASK_RX_SEND_RX_POWER:
+        pack_rxcmdframe_rxpower(frame, frame_stats);
+        rx_power_reported_dbm = sx.RfPower_dbm();
+        break;
+    case LINK_TASK_RX_SEND_MODE_SWITCH_ACK:
+        pack_rxcmdframe_modeswitchack(frame, frame_stats, mode_switch_mode, mode_switch_cnt);
+        break;
+    case LINK_TASK_RX_SEND_RC_LATENCY: {
+        tRxCmdFrameRcLatency rc_latency;
+        rclatency.Report(&rc_latency);
+        pack_rxcmdframe_rclatency(frame, frame_stats, &rc_latency);
+        }break;
     }
 }
 
 
+// switch mode on the fly, is called after a frame was transmitted and before the next is received
+// the fhss list is kept, so no need to touch fhss
+void link_mode_apply(uint8_t mode)
+{
+    int32_t toa_us = sx.TimeOverAir_us();
+
+    configure_mode(mode);
+    sx.SetToIdle();
+    sx2.SetToIdle();
+    sx.SetLoraConfigurationByIndex(Config.LoraConfigIndex);
+    sx2.SetLoraConfigurationByIndex(Config.LoraConfigIndex);
+
+    // the next tick was set with the old period, the tick after it uses the new period
+    // the next frame ends earlier or later since its time over air is different, so shift the clock
+    clock.SetPeriod(Config.frame_rate_ms);
+    clock.Shift(((int32_t)sx.TimeOverAir_us() - toa_us) / 10);
+
+    rxstats.SetPeriod(Config.LQAveragingPeriod);
+}
+
+
+// apply changed parameters while running, only for those which don't need a restart
+void params_apply_live(void)
+{
+    setup_configure_live_config(Config.ConfigId);
+
+    if (Setup.Rx.SerialBaudrate != SetupInUse_Rx.SerialBaudrate) {
+        serial.SetBaudRate(Config.SerialBaudrate);
+    }
+    out.Configure(Setup.Rx.OutMode); // does nothing if not changed
+    if (Setup.Rx.Power != SetupInUse_Rx.Power) {
+        powerctrl.Init(Config.Power_dbm, rfpower_list[0].dbm, Config.frame_rate_ms);
+        sx.SetRfPower_dbm(powerctrl.Power_dbm());
+        sx2.SetRfPower_dbm(powerctrl.Power_dbm());
+        fan.SetPower(sx.RfPower_dbm());
+    }
+
+    setup_set_in_use();
+}
+
+
 //-- normal Tx, Rx frames handling
 
 void prepare_transmit_frame(uint8_t antenna, uint8_t ack)
@@ -327,22 +425,34 @@ void prepare_transmit_frame(uint8_t antenna, uint8_t ack)
 uint8_t payload[FRAME_RX_PAYLOAD_LEN];
 uint8_t payload_len = 0;
 
+#ifdef USE_ARQ
+    bool resend = (transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL) && arq.PayloadPending();
+    arq.SetTransmitFrameType(transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL);
+
+    if (resend) {
+        // last payload was not acked, so resend it with the same seq no
+        payload_len = arq.GetPayload(payload);
+        stats.retransmit_cnt++;
+    } else
+#endif
     if (transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL) {
+#ifdef USE_ARQ
+        stats.transmit_seq_no++;
+#endif
 
         // read data from serial
         if (connected()) {
-            for (uint8_t i = 0; i < FRAME_RX_PAYLOAD_LEN; i++) {
-                if (!sx_serial.available()) break;
-                payload[payload_len] = sx_serial.getc();
-//dbg.putc(payload[payload_len]);
-                payload_len++;
-            }
+            payload_len = sx_serial.GetPayload(payload, Config.frame_rx_payload_len);
 
             stats.bytes_transmitted.Add(payload_len);
             stats.serial_data_transmitted.Inc();
         } else {
             sx_serial.flush();
         }
+
+#ifdef USE_ARQ
+        arq.SetPayload(payload, payload_len);
+#endif
     }
 
     stats.last_transmit_antenna = antenna;
@@ -383,11 +493,20 @@ void process_received_frame(bool do_payload, tTxFrame* frame)
 
     // handle cmd frame
     if (frame->status.frame_type == FRAME_TYPE_TX_RX_CMD) {
+        if (!txcmdframe_complete(frame)) return; // slim frames, wait for all chunks
         process_received_txcmdframe(frame);
         return;
     }
 
+    cmd_chunker.Reset();
+
     link_task_reset(); // clear it if non-cmd frame is received
+    params_store_done = false;
+
+#ifdef USE_ARQ
+    // a retransmission of a payload we already got
+    if (!arq.AcceptPayload(frame->status.seq_no)) return;
+#endif
 
     // output data on serial, but only if connected
     if (connected()) {
@@ -428,16 +547,26 @@ tTxFrame* frame;
         bool do_payload = (rx_status == RX_STATUS_VALID);
 
         process_received_frame(do_payload, frame);
+#ifdef USE_RC_LATENCY
+        // the Tx puts the age of the rc data into LQ_serial_data, is in the crc1 protected part
+        rclatency.Received(frame->status.LQ_serial_data, (antenna == ANTENNA_1) ? irq_rx_done_10us : irq2_rx_done_10us);
+#endif
 
         rxstats.doValidCrc1FrameReceived();
         if (rx_status == RX_STATUS_VALID) rxstats.doValidFrameReceived(); // should we count valid payload only if tx frame ?
 
         stats.received_seq_no = frame->status.seq_no;
-        stats.received_ack = frame->status.ack;
+        stats.received_ack = frame->status.ack; // is in the crc1 protected part, so also valid for CRC1_VALID
+#ifdef USE_ARQ
+        arq.SetReceived(do_payload);
+#endif
 
     } else { // RX_STATUS_INVALID
         stats.received_seq_no = UINT8_MAX;
         stats.received_ack = 0;
+#ifdef USE_ARQ
+        arq.SetReceived(false);
+#endif
     }
 
     // we set it for all received frames
@@ -452,30 +581,42 @@ void handle_receive_none(void) // RX_STATUS_NONE
 {
     stats.received_seq_no = UINT8_MAX;
     stats.received_ack = 0;
+#ifdef USE_ARQ
+    arq.SetReceived(false);
+#endif
 }
 
 
 void do_transmit(uint8_t antenna) // we send a frame to transmitter
 {
 uint8_t ack = 1;
+uint8_t len;
 
     if (bind.IsInBind()) {
         bind.do_transmit(antenna);
         return;
     }
 
+#ifdef USE_ARQ
+    arq.HandleAck(stats.received_ack);
+    ack = arq.Ack();
+#else
     stats.transmit_seq_no++;
+#endif
 
     prepare_transmit_frame(antenna, ack);
 
+    len = rxframe_shrink(&rxFrame);
+
     // to test asymmetric connection, fake rxFrame, to no send doesn't work as it blocks the sx
-    sxSendFrame(antenna, &rxFrame, FRAME_TX_RX_LEN, SEND_FRAME_TMO_MS); // 10ms tmo
+    sxSendFrame(antenna, &rxFrame, len, SEND_FRAME_TMO_MS); // 10ms tmo
 }
 
 
 uint8_t do_receive(uint8_t antenna, bool do_clock_reset) // we receive a frame from receiver
 {
 uint8_t res;
+uint8_t len;
 uint8_t rx_status = RX_STATUS_INVALID; // this also signals that a frame was received
 
     if (bind.IsInBind()) {
@@ -484,7 +625,10 @@ uint8_t rx_status = RX_STATUS_INVALID; // this also signals that a frame was rec
 
     // we don't need to read sx.GetRxBufferStatus(), but hey
     // we could save 2 byte's time by not reading sync_word again, but hey
-    sxReadFrame(antenna, &txFrame, &txFrame2, FRAME_TX_RX_LEN);
+    len = sxReadFrame(antenna, &txFrame, &txFrame2, Config.frame_len);
+
+    if (!txframe_expand((antenna == ANTENNA_1) ? &txFrame : &txFrame2, len)) return RX_STATUS_INVALID;
+
     res = (antenna == ANTENNA_1) ? check_txframe(&txFrame) : check_txframe(&txFrame2);
 
     if (res) {
@@ -498,7 +642,13 @@ dbg.puts("fail a");dbg.putc(antenna+'0');dbg.puts(" ");dbg.puts(u8toHEX_s(res));
 
     if (res == CHECK_OK || res == CHECK_ERROR_CRC) {
 
-        if (do_clock_reset) clock.Reset();
+        uint32_t rx_done_10us = (antenna == ANTENNA_1) ? irq_rx_done_10us : irq2_rx_done_10us;
+#ifdef USE_VARIABLE_FRAME_LEN
+        // a shorter frame ends earlier, shift the clock such as to stay aligned to the frame slots
+        if (do_clock_reset) clock.ResetAt(rx_done_10us, (sx.TimeOverAir_us() - sx.TimeOverAir_us(len)) / 10);
+#else
+        if (do_clock_reset) clock.ResetAt(rx_done_10us);
+#endif
 
         rx_status = (res == CHECK_OK) ? RX_STATUS_VALID : RX_STATUS_CRC1_VALID;
     }
@@ -578,22 +728,38 @@ RESTARTCONTROLLER:
   frame_missed = false;
 
   rxstats.Init(Config.LQAveragingPeriod);
+#ifdef USE_ARQ
+  arq.Init();
+#endif
+  cmd_chunker.Init();
+  rclatency.Init();
 
   out.Configure(Setup.Rx.OutMode);
   mavlink.Init();
   sx_serial.Init();
   fan.SetPower(sx.RfPower_dbm());
+  powerctrl.Init(Config.Power_dbm, rfpower_list[0].dbm, Config.frame_rate_ms);
+  rx_power_reported_dbm = sx.RfPower_dbm();
+  modeadapt.Init(Config.Mode);
+  mode_switch_cnt = 0;
+  mode_switch_confirmed = false;
+  doModeSwitch = false;
 
   led_blink = 0;
   tick_1hz = 0;
   tick_1hz_commensurate = 0;
   doSysTask = 0; // helps in avoiding too short first loop
+#ifdef USE_PROFILER
+  profiler.Init();
+#endif
   while (1) {
+    PROFILE_LOOP();
 
     //-- SysTask handling
 
     if (doSysTask) {
         doSysTask = 0;
+        PROFILE_START(PROFILE_SYSTASK);
 
         if (connect_tmo_cnt) {
             connect_tmo_cnt--;
@@ -622,6 +788,8 @@ RESTARTCONTROLLER:
 
         if (!tick_1hz) {
             dbg.puts(".");
+            DBG_MAIN(int16_t drift_ppm = clock.Drift_ppm();
+                dbg.puts("\ndrift: "); dbg.puts(s8toBCD_s((drift_ppm < -128) ? -128 : (drift_ppm > 127) ? 127 : drift_ppm)); dbg.puts(" ppm");)
 /*            dbg.puts("\nRX: ");
             dbg.puts(u8toBCD_s(rxstats.GetLQ())); dbg.putc(',');
             dbg.puts(u8toBCD_s(rxstats.GetLQ_serial_data()));
@@ -638,13 +806,31 @@ RESTARTCONTROLLER:
 
             dbg.puts(u16toBCD_s(stats.bytes_transmitted.GetBytesPerSec())); dbg.puts(", ");
             dbg.puts(u16toBCD_s(stats.bytes_received.GetBytesPerSec())); dbg.puts("; "); */
+#ifdef USE_PROFILER
+            dbg.puts("\nperf: "); dbg.puts(u32toBCD_s(profiler.LoopFrequency_hz()));
+            dbg.putc(','); dbg.puts(u32toBCD_s(profiler.loop_max_us)); dbg.puts("; ");
+            for (uint8_t i = 0; i < PROFILE_NUM; i++) {
+                if (i == PROFILE_WHILE || i == PROFILE_TASKS) continue; // not used by Rx
+                dbg.puts(u32toBCD_s(profiler.SectionAvg_us(i))); dbg.putc(',');
+                dbg.puts(u32toBCD_s(profiler.SectionMax_us(i))); dbg.puts("; ");
+            }
+            profiler.Reset();
+#endif
         }
+        PROFILE_END(PROFILE_SYSTASK);
     }
 
     //-- SX handling
 
+    PROFILE_START(PROFILE_SX);
     switch (link_state) {
     case LINK_STATE_RECEIVE: {
+#ifdef USE_MODE_ADAPTIVE
+        if (doModeSwitch) {
+            doModeSwitch = false;
+            link_mode_apply(mode_switch_mode);
+        }
+#endif
         if (connect_state >= CONNECT_STATE_SYNC) { // we hop only if not in listen
             fhss.HopToNext();
         }
@@ -726,10 +912,27 @@ IF_ANTENNA2(
         }
     }//end of if(irq2_status)
 );
+    PROFILE_END(PROFILE_SX);
+
+    // write the flash right after a transmission, the cpu stalls for a while, e.g. a page erase takes
+    // about 20 - 40 ms, which is longer than a frame at higher rates
+    // the clock isr then skips the ticks which were missed, keeping the phase, and we hop over them
+    // so that we stay in sync with the Tx, the frames in the stall are lost, but the link is not
+    // not done while a mode switch is pending, since it could be skipped
+    if (doParamsStoreEEPROM && (link_state == LINK_STATE_RECEIVE) && !mode_switch_cnt && !doModeSwitch) {
+        doParamsStoreEEPROM = false;
+        clock.TicksSkipped(); // clear
+        setup_store_to_EEPROM();
+        uint8_t ticks_skipped = clock.TicksSkipped();
+        if (connect_state >= CONNECT_STATE_SYNC) {
+            for (uint8_t n = 0; n < ticks_skipped; n++) fhss.HopToNext();
+        }
+    }
 
     // this happens ca 1 ms after a frame was or should have been received
     if (doPostReceive) {
         doPostReceive = false;
+        PROFILE_START(PROFILE_FRAME);
 
         bool frame_received, valid_frame_received, invalid_frame_received;
         frame_received = valid_frame_received = invalid_frame_received = false; // to make compiler happy
@@ -835,6 +1038,12 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
             connect_state = CONNECT_STATE_LISTEN;
             connect_listen_cnt = 0;
             link_state = LINK_STATE_RECEIVE; // switch back to RX
+#ifdef USE_MODE_ADAPTIVE
+            // fall back to the setup mode, the Tx does the same
+            mode_switch_cnt = 0;
+            doModeSwitch = false;
+            if (Config.Mode != modeadapt.ModeBase() && !bind.IsInBind()) link_mode_apply(modeadapt.ModeBase());
+#endif
         }
 
         // we didn't receive a valid frame
@@ -849,6 +1058,14 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
             link_state = LINK_STATE_TRANSMIT;
         }
 
+#ifdef USE_MODE_ADAPTIVE
+        // the switch is done after this frame slot's transmission, i.e. right before the frame at cnt is received
+        if (mode_switch_cnt) {
+            mode_switch_cnt--;
+            if (!mode_switch_cnt && mode_switch_confirmed) doModeSwitch = true;
+        }
+#endif
+
 #ifdef DEVICE_HAS_SX127x
         if ((connect_state >= CONNECT_STATE_SYNC) || (link_state == LINK_STATE_RECEIVE)) {
 #else
@@ -863,7 +1080,35 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
             rxstats.Update1Hz();
         }
         rxstats.Next();
-        if (!connected()) rxstats.Clear();
+        if (!connected()) {
+            rxstats.Clear();
+#ifdef USE_ARQ
+            arq.Reset();
+#endif
+        }
+
+#ifdef USE_FHSS_ADAPTIVE
+        if (connected()) fhss.SetHopStats(valid_frame_received, stats.GetLastRssi());
+#endif
+        if (!connected()) fhss.ResetSwaps(); // ensures both sides use the same list on connect
+
+#ifdef USE_DYNAMIC_POWER
+        if (connected() ? powerctrl.Update(valid_frame_received, stats.received_rssi, sx.ReceiverSensitivity_dbm()) :
+                          powerctrl.Reset()) {
+            sx.SetRfPower_dbm(powerctrl.Power_dbm());
+            sx2.SetRfPower_dbm(powerctrl.Power_dbm());
+            fan.SetPower(sx.RfPower_dbm());
+        }
+        // report the actual power to the Tx, checked once per sec
+        if (connected() && !tick_1hz_commensurate && (link_task == LINK_TASK_NONE) && (sx.RfPower_dbm() != rx_power_reported_dbm)) {
+            link_task_set(LINK_TASK_RX_SEND_RX_POWER);
+        }
+#endif
+#ifdef USE_RC_LATENCY
+        if (connected() && !tick_1hz_commensurate && (link_task == LINK_TASK_NONE)) {
+            link_task_set(LINK_TASK_RX_SEND_RC_LATENCY);
+        }
+#endif
 
         if (connect_state == CONNECT_STATE_LISTEN) {
             link_task_reset();
@@ -878,7 +1123,7 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
         switch (bind.Task()) {
         case BIND_TASK_CHANGED_TO_BIND:
             bind.ConfigForBind();
-            CLOCK_PERIOD_10US = ((uint16_t)Config.frame_rate_ms * 100);
+            clock.SetPeriod(Config.frame_rate_ms);
             clock.Reset();
             fhss.SetToBind(Config.frame_rate_ms);
             LED_GREEN_ON;
@@ -893,10 +1138,13 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
         }
 
         doPostReceive2_cnt = 5; // allow link_state changes to be handled, so postpone this few loops
+        PROFILE_END(PROFILE_FRAME);
     }//end of if(doPostReceive)
 
     //-- Update channels, Out handling, etc
 
+    PROFILE_START(PROFILE_CHANNELS);
+
     if (doPostReceive2_cnt) {
         doPostReceive2_cnt--;
         if (!doPostReceive2_cnt) doPostReceive2 = true;
@@ -907,6 +1155,9 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
         out.SetChannelOrder(Setup.Rx.ChannelOrder);
         if (connected()) {
             out.SendRcData(&rcData, frame_missed, false, stats.GetLastRssi(), rxstats.GetLQ());
+#ifdef USE_RC_LATENCY
+            rclatency.Output(frame_missed, clock.tim_10us(), sx.TimeOverAir_us());
+#endif
             out.SendLinkStatistics();
             mavlink.SendRcData(out.GetRcDataPtr(), false);
         } else {
@@ -920,19 +1171,28 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
     }//end of if(doPostReceive2)
 
     out.Do(micros());
+    PROFILE_END(PROFILE_CHANNELS);
 
     //-- Do mavlink
 
+    PROFILE_START(PROFILE_MAVLINK);
     mavlink.Do();
+    PROFILE_END(PROFILE_MAVLINK);
 
     //-- Store parameters
 
     if (doParamsStore) {
-        sx.SetToIdle();
-        sx2.SetToIdle();
-        LED_RED_ON; LED_GREEN_ON;
-        setup_store_to_EEPROM();
-        goto RESTARTCONTROLLER;
+        if (setup_needs_restart()) {
+            sx.SetToIdle();
+            sx2.SetToIdle();
+            LED_RED_ON; LED_GREEN_ON;
+            setup_store_to_EEPROM();
+            goto RESTARTCONTROLLER;
+        }
+        doParamsStore = false;
+        params_store_done = true;
+        params_apply_live();
+        doParamsStoreEEPROM = true; // is done after the next transmission
     }
 
   }//end of while(1) loop
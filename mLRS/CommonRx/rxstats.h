@@ -21,6 +21,7 @@ class RxStatsBase
 {
   public:
     void Init(uint8_t _period);
+    void SetPeriod(uint8_t _period); // called then the frame rate changed
 
     void Update1Hz(void); // called at 1 Hz
     void Next(void); // called at each cycle
@@ -50,6 +51,14 @@ void RxStatsBase::Init(uint8_t _period)
 }
 
 
+void RxStatsBase::SetPeriod(uint8_t _period)
+{
+    LQma_valid_crc1.ChangePeriod(_period);
+    LQma_valid.ChangePeriod(_period);
+    LQma_received.ChangePeriod(_period);
+}
+
+
 void RxStatsBase::Update1Hz(void)
 {
     stats.Update1Hz();
@@ -18,6 +18,7 @@ class tRxSxSerial : public tSerialBase
       void Init(void)
       {
           tSerialBase::Init();
+          packer.Init();
       }
 
       virtual bool available(void)
@@ -40,6 +41,7 @@ class tRxSxSerial : public tSerialBase
       {
           mavlink.flush(); // we don't distinguish here, can't harm to always flush mavlink handler
           serial.flush();
+          packer.Flush();
       }
 
       virtual void putc(char c)
@@ -50,6 +52,33 @@ class tRxSxSerial : public tSerialBase
               serial.putc(c); // send to serial
           }
       }
+
+      // fills the payload with data from serial, returns the number of bytes
+      uint8_t GetPayload(uint8_t* payload, uint8_t payload_max_len)
+      {
+#ifdef USE_MAVLINK_PACKING
+          if (Setup.Rx.SerialLinkMode == SERIAL_LINK_MODE_MAVLINK) {
+              return packer.GetPayload(this, payload, payload_max_len);
+          }
+#endif
+          uint8_t payload_len = 0;
+          while ((payload_len < payload_max_len) && available()) {
+              payload[payload_len++] = getc();
+          }
+          return payload_len;
+      }
+
+      // bytes held back by the packer
+      uint16_t bytes_held(void)
+      {
+#ifdef USE_MAVLINK_PACKING
+          if (Setup.Rx.SerialLinkMode == SERIAL_LINK_MODE_MAVLINK) return packer.BytesHeld();
+#endif
+          return 0;
+      }
+
+  private:
+      MavlinkPacker packer;
 };
 
 
@@ -0,0 +1,150 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// Black Box for Transmitter
+//********************************************************
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+#pragma once
+
+
+#include <inttypes.h>
+
+
+//-------------------------------------------------------
+// Black Box
+//-------------------------------------------------------
+// ring buffer of compact per-frame records, which keeps the last BLACKBOX_RECORD_NUM frame slots
+// it can be dumped in binary via the CLI with "bbdump", tools/run_blackbox_summary.py decodes it
+//
+// dump format, all little endian:
+//   "MBB" + version (1 byte)
+//   uint16 record size, uint16 record num, uint16 frame rate in ms, uint8 mode
+//   records, oldest first
+//   uint8 crc8 over the records, poly 0xD5
+
+#define BLACKBOX_RECORD_NUM       256 // must be power of 2
+#define BLACKBOX_VERSION          1
+#define BLACKBOX_CHECK_NONE       255 // check_res if no frame was received
+
+PACKED(
+typedef struct
+{
+    uint16_t frame_cnt; // counts frame slots
+    uint8_t fhss_i;
+    uint8_t rx1_status : 2; // RX_STATUS_xxx
+    uint8_t rx2_status : 2;
+    uint8_t antenna : 1; // selected antenna
+    uint8_t connected : 1;
+    uint8_t spare : 2;
+    uint8_t check_res; // CHECK_xxx of the selected antenna
+    uint8_t payload_len;
+    int8_t rssi1;
+    int8_t rssi2;
+    int8_t snr1;
+    int8_t snr2;
+    uint16_t rx_time_us; // RX_DONE of the selected antenna relative to start of transmission in the slot
+}) tBlackBoxRecord; // 12 bytes
+
+
+class tBlackBox
+{
+  public:
+    void Init(void)
+    {
+        writepos = 0;
+        num = 0;
+        frame_cnt = 0;
+        frozen = false;
+        transmit_us = 0;
+        clear_received();
+    }
+
+    // called then the frame of the slot is transmitted
+    void Transmit(uint16_t tnow_us)
+    {
+        transmit_us = tnow_us;
+    }
+
+    // called for each antenna which received a frame
+    void Received(uint8_t antenna, uint8_t check_res, uint8_t payload_len, uint16_t rx_done_us)
+    {
+        uint8_t i = (antenna == ANTENNA_1) ? 0 : 1;
+        received[i] = true;
+        received_check_res[i] = check_res;
+        received_payload_len[i] = payload_len;
+        received_time_us[i] = rx_done_us - transmit_us;
+    }
+
+    // called once per frame slot, after the antenna was selected
+    void Add(uint8_t fhss_i, uint8_t rx1_status, uint8_t rx2_status, uint8_t antenna, bool connected)
+    {
+        frame_cnt++;
+
+        if (!frozen) {
+            tBlackBoxRecord* rec = &(records[writepos]);
+            uint8_t i = (antenna == ANTENNA_1) ? 0 : 1;
+
+            rec->frame_cnt = frame_cnt;
+            rec->fhss_i = fhss_i;
+            rec->rx1_status = rx1_status;
+            rec->rx2_status = rx2_status;
+            rec->antenna = i;
+            rec->connected = (connected) ? 1 : 0;
+            rec->spare = 0;
+            rec->check_res = (received[i]) ? received_check_res[i] : BLACKBOX_CHECK_NONE;
+            rec->payload_len = (received[i]) ? received_payload_len[i] : 0;
+            rec->rssi1 = (received[0]) ? stats.last_rssi1 : RSSI_INVALID;
+            rec->rssi2 = (received[1]) ? stats.last_rssi2 : RSSI_INVALID;
+            rec->snr1 = (received[0]) ? stats.last_snr1 : SNR_INVALID;
+            rec->snr2 = (received[1]) ? stats.last_snr2 : SNR_INVALID;
+            rec->rx_time_us = (received[i]) ? received_time_us[i] : 0;
+
+            writepos = (writepos + 1) & (BLACKBOX_RECORD_NUM - 1);
+            if (num < BLACKBOX_RECORD_NUM) num++;
+        }
+
+        clear_received();
+    }
+
+    // stops recording, e.g. while the records are dumped
+    void Freeze(bool flag)
+    {
+        frozen = flag;
+    }
+
+    uint16_t Num(void)
+    {
+        return num;
+    }
+
+    // i = 0 is the oldest record
+    tBlackBoxRecord* Get(uint16_t i)
+    {
+        return &(records[(writepos - num + i) & (BLACKBOX_RECORD_NUM - 1)]);
+    }
+
+  private:
+    void clear_received(void)
+    {
+        received[0] = received[1] = false;
+    }
+
+    tBlackBoxRecord records[BLACKBOX_RECORD_NUM];
+    uint16_t writepos;
+    uint16_t num;
+    uint16_t frame_cnt;
+    bool frozen;
+
+    uint16_t transmit_us;
+    bool received[2];
+    uint8_t received_check_res[2];
+    uint8_t received_payload_len[2];
+    uint16_t received_time_us[2];
+};
+
+
+#endif // BLACKBOX_H
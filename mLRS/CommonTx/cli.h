@@ -16,6 +16,15 @@
 #include "setup_tx.h"
 extern TxStatsBase txstats;
 extern tConfigId config_id;
+#ifdef USE_BLACKBOX
+extern tBlackBox bbox;
+#endif
+#ifdef USE_MAVLINK_PARAM_CACHE
+extern tMavlinkParamCache paramcache;
+#endif
+#ifdef USE_MAVLINK_UPLINK_FLOW_CONTROL
+extern tMavlinkUplinkFlow uplinkflow;
+#endif
 
 
 //-------------------------------------------------------
@@ -281,6 +290,7 @@ class tTxCli
     typedef enum {
         CLI_STATE_NORMAL = 0,
         CLI_STATE_STATS,
+        CLI_STATE_BLACKBOX,
     } CLI_STATE_ENUM;
 
     void addc(uint8_t c);
@@ -291,6 +301,12 @@ class tTxCli
     void print_param_opt_list(uint8_t idx);
     void print_device_version(void);
     void stream(void);
+    void blackbox_dump_start(void);
+    void blackbox_dump_end(void);
+    void print_rc_latency(void);
+    void print_profiler(void);
+    void print_param_cache(void);
+    void print_uplink_flow(void);
 
     bool is_cmd(const char* cmd);
     bool is_cmd_param_set(char* name, char* svalue);
@@ -315,6 +331,8 @@ class tTxCli
     int32_t task_value;
 
     uint8_t state;
+    uint16_t bb_pos;
+    uint8_t bb_crc;
 };
 
 
@@ -581,6 +599,143 @@ void tTxCli::stream(void)
             putsn(";");
         }
     }
+
+#ifdef USE_BLACKBOX
+    if (state == CLI_STATE_BLACKBOX) {
+        // we send a few records per call, so as to not overrun the com tx buffer
+        for (uint8_t n = 0; n < 4; n++) {
+            if (bb_pos >= bbox.Num()) { blackbox_dump_end(); return; }
+            tBlackBoxRecord* rec = bbox.Get(bb_pos);
+            com->putbuf(rec, sizeof(tBlackBoxRecord));
+            bb_crc = crc8_update(bb_crc, rec, sizeof(tBlackBoxRecord), 0xD5);
+            bb_pos++;
+        }
+    }
+#endif
+}
+
+
+void tTxCli::blackbox_dump_start(void)
+{
+#ifdef USE_BLACKBOX
+    bbox.Freeze(true);
+
+    uint16_t rec_size = sizeof(tBlackBoxRecord);
+    uint16_t rec_num = bbox.Num();
+    uint16_t frame_rate_ms = Config.frame_rate_ms;
+
+    puts("MBB");
+    putc(BLACKBOX_VERSION);
+    com->putbuf(&rec_size, 2);
+    com->putbuf(&rec_num, 2);
+    com->putbuf(&frame_rate_ms, 2);
+    putc(Config.Mode);
+
+    bb_pos = 0;
+    bb_crc = 0;
+    state = CLI_STATE_BLACKBOX;
+#endif
+}
+
+
+void tTxCli::blackbox_dump_end(void)
+{
+#ifdef USE_BLACKBOX
+    putc(bb_crc);
+    bbox.Freeze(false);
+    state = CLI_STATE_NORMAL;
+#endif
+}
+
+
+void tTxCli::print_rc_latency(void)
+{
+#ifdef USE_RC_LATENCY
+tRxCmdFrameRcLatency lat;
+
+    if (!connected() || !rclatency.GetReport(&lat)) {
+        putsn("  no rc latency data");
+        return;
+    }
+    if (!lat.cnt) {
+        putsn("  no rc data received");
+        return;
+    }
+
+    puts("  cnt "); putsn(u16toBCD_s(lat.cnt));
+    puts("  min "); puts(u16toBCD_s(lat.min_us)); putsn(" us");
+    puts("  avg "); puts(u16toBCD_s(lat.avg_us)); putsn(" us");
+    puts("  max "); puts(u16toBCD_s(lat.max_us)); putsn(" us");
+    puts("  std "); puts(u16toBCD_s(lat.std_us)); putsn(" us");
+    delay_ms(10);
+    for (uint8_t i = 0; i < RC_LATENCY_HIST_NUM; i++) {
+        if (!lat.hist[i]) continue;
+        puts("  "); puts(u8toBCD_s(i * (RC_LATENCY_HIST_BIN_US / 1000)));
+        puts((i < RC_LATENCY_HIST_NUM - 1) ? " ms: " : "+ms: ");
+        puts(u8toBCD_s(lat.hist[i])); putsn("%");
+    }
+#endif
+}
+
+
+void tTxCli::print_profiler(void)
+{
+#ifdef USE_PROFILER
+    puts("  loop "); puts(u32toBCD_s(profiler.LoopFrequency_hz()));
+    puts(" Hz, max "); puts(u32toBCD_s(profiler.loop_max_us)); putsn(" us");
+    for (uint8_t i = 0; i < PROFILE_NUM; i++) {
+        puts("  "); puts(profile_section_names[i]);
+        puts(": avg "); puts(u32toBCD_s(profiler.SectionAvg_us(i)));
+        puts(" us, max "); puts(u32toBCD_s(profiler.SectionMax_us(i))); putsn(" us");
+        if (i == 3) delay_ms(10);
+    }
+    puts("  overruns "); puts(u16toBCD_s(profiler.overrun_cnt));
+    puts(", max "); puts(u32toBCD_s(profiler.overrun_max_us)); putsn(" us");
+    profiler.Reset();
+#endif
+}
+
+
+void tTxCli::print_param_cache(void)
+{
+#ifdef USE_MAVLINK_PARAM_CACHE
+    if (!paramcache.sysid) {
+        putsn("  no parameters cached");
+        return;
+    }
+
+    puts("  sysid "); puts(u8toBCD_s(paramcache.sysid));
+    puts(", compid "); putsn(u8toBCD_s(paramcache.compid));
+    puts("  params "); puts(u16toBCD_s(paramcache.Received()));
+    puts(" of "); puts(u16toBCD_s(paramcache.Count()));
+    if (paramcache.Overflow()) puts(", too many");
+    putsn("");
+    puts("  pool "); puts(u16toBCD_s(paramcache.PoolUsed()));
+    puts(" of "); puts(u32toBCD_s(MAVLINK_PARAM_CACHE_POOL_SIZE)); putsn(" bytes");
+    delay_ms(10);
+    if (paramcache.Complete()) {
+        puts("  hash "); putsn(u32toBCD_s(paramcache.Hash()));
+    }
+    puts("  served list "); puts(u16toBCD_s(paramcache.served_list_cnt));
+    puts(", read "); putsn(u16toBCD_s(paramcache.served_read_cnt));
+#endif
+}
+
+
+void tTxCli::print_uplink_flow(void)
+{
+#ifdef USE_MAVLINK_UPLINK_FLOW_CONTROL
+    puts("  fill "); puts(u16toBCD_s(uplinkflow.fill));
+    puts(" of "); puts(u16toBCD_s(uplinkflow.size - 1));
+    puts(", max "); putsn(u16toBCD_s(uplinkflow.fill_max));
+    puts("  txbuf "); puts(u8toBCD_s(uplinkflow.Txbuf())); putsn(" %");
+    delay_ms(10);
+    puts("  full "); puts(u16toBCD_s(uplinkflow.full_cnt));
+    if (Setup.Tx[Config.ConfigId].SerialDestination == SERIAL_DESTINATION_MBRDIGE) {
+        puts(", lost "); puts(u16toBCD_s(uplinkflow.lost_cnt)); puts(" bytes");
+    }
+    putsn("");
+#endif
 }
 
 
@@ -622,6 +777,21 @@ void tTxCli::print_help(void)
     putsn("  bind        -> start binding");
     putsn("  reload      -> reload all parameter settings");
     putsn("  stats       -> starts streaming statistics");
+#ifdef USE_BLACKBOX
+    putsn("  bbdump      -> dump black box records in binary");
+#endif
+#ifdef USE_RC_LATENCY
+    putsn("  lat         -> print rc latency statistics");
+#endif
+#ifdef USE_PROFILER
+    putsn("  perf        -> print main loop profile, and restart it");
+#endif
+#ifdef USE_MAVLINK_PARAM_CACHE
+    putsn("  pcache      -> print MAVLink parameter cache status");
+#endif
+#ifdef USE_MAVLINK_UPLINK_FLOW_CONTROL
+    putsn("  uplink      -> print uplink flow control status");
+#endif
     delay_ms(10);
 
     putsn("  ptser       -> enter serial passthrough");
@@ -703,6 +873,11 @@ bool rx_param_changed;
     uint32_t tnow_ms = millis32();
     if (pos && (tnow_ms - tlast_ms > 2000)) { putsn(">"); putsn("  timeout"); clear(); }
 
+    if (state == CLI_STATE_BLACKBOX) { // binary dump, is not interrupted
+        stream();
+        return;
+    }
+
     if (state != CLI_STATE_NORMAL) {
         if (com->available()) { com->getc(); state = CLI_STATE_NORMAL; putsn("  streaming stats stopped"); return; }
         stream();
@@ -792,6 +967,33 @@ bool rx_param_changed;
             state = CLI_STATE_STATS;
             putsn("  starts streaming stats");
             putsn("  send any character to stop");
+#ifdef USE_BLACKBOX
+        } else
+        if (is_cmd("bbdump")) {
+            blackbox_dump_start();
+            clear();
+            return; // further input is handled after the dump
+#endif
+#ifdef USE_RC_LATENCY
+        } else
+        if (is_cmd("lat")) {
+            print_rc_latency();
+#endif
+#ifdef USE_PROFILER
+        } else
+        if (is_cmd("perf")) {
+            print_profiler();
+#endif
+#ifdef USE_MAVLINK_PARAM_CACHE
+        } else
+        if (is_cmd("pcache")) {
+            print_param_cache();
+#endif
+#ifdef USE_MAVLINK_UPLINK_FLOW_CONTROL
+        } else
+        if (is_cmd("uplink")) {
+            print_uplink_flow();
+#endif
 
         //-- System Bootloader
         } else
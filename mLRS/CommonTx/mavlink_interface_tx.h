@@ -16,12 +16,19 @@
 
 static inline bool connected_and_rx_setup_available(void);
 extern tSerialBase* serialport;
+#ifdef USE_MAVLINK_UPLINK_FLOW_CONTROL
+extern tMavlinkUplinkFlow uplinkflow;
+#endif
 
 
 #define RADIO_STATUS_SYSTEM_ID      51 // SiK uses 51, 68
 
 #define MAVLINK_BUF_SIZE            300 // needs to be larger than max mavlink frame size = 286 bytes
 
+#define MAVLINK_SERIAL_IN_TMO_MS    100 // an incomplete message from serial is held back for at most this time
+#define MAVLINK_VEHICLE_TMO_MS      5000 // the vehicle is considered lost if no heartbeat for this time
+#define MAVLINK_PARAM_CHECK_TMO_MS  1500 // the param list request is forwarded if the cache check isn't answered within this time
+
 
 class MavlinkBase
 {
@@ -36,9 +43,17 @@ class MavlinkBase
     void flush(void);
 
   private:
+    void parse_link_in(char c);
     void send_msg_serial_out(void);
     void handle_msg_serial_out(void);
     void generate_radio_status(void);
+#ifdef USE_MAVLINK_PARAM_CACHE
+    void fill_serial_in(void);
+    bool handle_msg_serial_in(void);
+    void generate_param_value(uint16_t index);
+    void generate_param_request_read(void);
+    void param_list_start(void);
+#endif
 
     // fields for link in -> serial out parser
     fmav_status_t status_link_in;
@@ -46,6 +61,9 @@ class MavlinkBase
     uint8_t buf_link_in[MAVLINK_BUF_SIZE]; // buffer for link in parser
     fmav_status_t status_serial_out;
     fmav_message_t msg_serial_out;
+#ifdef USE_MAVLINK_COMPRESSION
+    MavlinkUnpacker unpacker_link_in;
+#endif
 
     // to inject RADIO_STATUS messages
     uint32_t radio_status_tlast_ms;
@@ -55,6 +73,37 @@ class MavlinkBase
     uint8_t vehicle_is_flying;
     uint8_t vehicle_type;
     uint8_t vehicle_flight_mode;
+    uint32_t vehicle_heartbeat_tlast_ms;
+
+#ifdef USE_MAVLINK_PARAM_CACHE
+    // fields for serial in -> link out, to intercept param requests
+    uint8_t buf_serial_in[MAVLINK_BUF_SIZE];
+    uint16_t serial_in_len; // number of bytes in buf
+    uint16_t serial_in_pos; // number of bytes handed out
+    uint16_t serial_in_msg_len; // length of the message in buf, 0 if not yet known
+    bool serial_in_released; // bytes in buf can be handed out
+    uint32_t serial_in_tstart_ms;
+    fmav_status_t status_serial_in;
+    fmav_result_t result_serial_in;
+    fmav_message_t msg_serial_in;
+
+    // to send the param list from the cache
+    uint16_t param_list_index; // UINT16_MAX if not sending
+    uint32_t param_list_tlast_ms;
+    uint16_t param_list_interval_ms;
+
+    // to check the cache before the param list is sent from it
+    bool param_check_pending; // waiting for the vehicle's answer to the check
+    bool param_list_forward; // the cache is not valid, send the param list request to the vehicle
+    uint32_t param_check_tstart_ms;
+    uint8_t param_list_request_buf[16]; // the original param list request, is at most 14 bytes if not signed
+    uint16_t param_list_request_len;
+    uint8_t param_list_gcs_sysid; // of the GCS's param list request
+    uint8_t param_list_gcs_compid;
+    uint8_t param_list_target_sysid;
+    uint8_t param_list_target_compid;
+    uint32_t vehicle_time_boot_ms; // to detect a reboot of the vehicle
+#endif
 
     uint8_t _buf[MAVLINK_BUF_SIZE]; // temporary working buffer, to not burden stack
 };
@@ -67,6 +116,9 @@ void MavlinkBase::Init(void)
     result_link_in = {};
     status_link_in = {};
     status_serial_out = {};
+#ifdef USE_MAVLINK_COMPRESSION
+    unpacker_link_in.Init();
+#endif
 
     radio_status_tlast_ms = millis32() + 1000;
 
@@ -75,6 +127,21 @@ void MavlinkBase::Init(void)
     vehicle_is_flying = UINT8_MAX;
     vehicle_type = UINT8_MAX;
     vehicle_flight_mode = UINT8_MAX;
+    vehicle_heartbeat_tlast_ms = 0;
+
+#ifdef USE_MAVLINK_PARAM_CACHE
+    serial_in_len = serial_in_pos = serial_in_msg_len = 0;
+    serial_in_released = false;
+    status_serial_in = {};
+    param_list_index = UINT16_MAX;
+    param_check_pending = false;
+    param_list_forward = false;
+    vehicle_time_boot_ms = 0;
+    paramcache.Init();
+#endif
+#ifdef USE_MAVLINK_UPLINK_FLOW_CONTROL
+    uplinkflow.Init(TX_SERIAL_RXBUFSIZE);
+#endif
 }
 
 
@@ -90,8 +157,47 @@ void MavlinkBase::Do(void)
 
     if (Setup.Rx.SerialLinkMode != SERIAL_LINK_MODE_MAVLINK) return;
 
+#ifdef USE_MAVLINK_PARAM_CACHE
+    if (paramcache.sysid && (tnow_ms - vehicle_heartbeat_tlast_ms) > MAVLINK_VEHICLE_TMO_MS) {
+        paramcache.Clear(); // vehicle lost, it may have rebooted
+        param_list_index = UINT16_MAX;
+    }
+
+    if (param_check_pending && (tnow_ms - param_check_tstart_ms) > MAVLINK_PARAM_CHECK_TMO_MS) {
+        param_check_pending = false;
+        param_list_forward = true; // no answer, let the vehicle respond to the param list request
+    }
+
+    if (param_list_index != UINT16_MAX && (tnow_ms - param_list_tlast_ms) >= param_list_interval_ms) {
+        param_list_tlast_ms = tnow_ms;
+        if (param_list_index < paramcache.Count() && paramcache.Complete()) {
+            generate_param_value(param_list_index);
+            send_msg_serial_out();
+            param_list_index++;
+        } else {
+            param_list_index = UINT16_MAX; // done
+        }
+    }
+#endif
+
+#ifdef USE_MAVLINK_UPLINK_FLOW_CONTROL
+    // the destination can be changed live, so check the fifo size
+    uint16_t fifo_size = (Setup.Tx[Config.ConfigId].SerialDestination == SERIAL_DESTINATION_MBRDIGE) ?
+                                 TX_MBRIDGE_RXBUFSIZE : TX_SERIAL_RXBUFSIZE;
+    if (uplinkflow.size != fifo_size) uplinkflow.Init(fifo_size);
+    if (serialport) uplinkflow.Update(serialport->bytes_available());
+#if (defined DEVICE_HAS_JRPIN5)
+    if (Setup.Tx[Config.ConfigId].SerialDestination == SERIAL_DESTINATION_MBRDIGE) {
+        uplinkflow.lost_cnt = mbridge.serial_rx_overflow_cnt;
+    }
+#endif
+    uint16_t radio_status_interval_ms = uplinkflow.Interval_ms();
+#else
+    uint16_t radio_status_interval_ms = 1000;
+#endif
+
     if (Setup.Tx[Config.ConfigId].SendRadioStatus) {
-        if ((tnow_ms - radio_status_tlast_ms) >= 1000) {
+        if ((tnow_ms - radio_status_tlast_ms) >= radio_status_interval_ms) {
             radio_status_tlast_ms = tnow_ms;
             inject_radio_status = true;
         }
@@ -116,6 +222,19 @@ uint8_t MavlinkBase::VehicleState(void)
 
 
 void MavlinkBase::putc(char c)
+{
+#ifdef USE_MAVLINK_COMPRESSION
+    // rebuild compressed frames first
+    uint16_t len = unpacker_link_in.Put(c);
+    uint8_t* buf = unpacker_link_in.Buf();
+    for (uint16_t i = 0; i < len; i++) parse_link_in(buf[i]);
+#else
+    parse_link_in(c);
+#endif
+}
+
+
+void MavlinkBase::parse_link_in(char c)
 {
     // parse link in -> serial out
     if (fmav_parse_and_check_to_frame_buf(&result_link_in, buf_link_in, &status_link_in, c)) {
@@ -136,7 +255,12 @@ bool MavlinkBase::available(void)
 {
     if (!serialport) return false; // should not happen
 
+#ifdef USE_MAVLINK_PARAM_CACHE
+    fill_serial_in();
+    return (serial_in_released && (serial_in_pos < serial_in_len));
+#else
     return serialport->available();
+#endif
 }
 
 
@@ -144,12 +268,28 @@ uint8_t MavlinkBase::getc(void)
 {
     if (!serialport) return 0; // should not happen
 
+#ifdef USE_MAVLINK_PARAM_CACHE
+    if (!serial_in_released || (serial_in_pos >= serial_in_len)) return 0; // should not happen
+    return buf_serial_in[serial_in_pos++];
+#else
     return serialport->getc();
+#endif
 }
 
 
 void MavlinkBase::flush(void)
 {
+    result_link_in = {}; // drop a partially parsed message, the link may come back with another link mode
+    status_link_in = {};
+#ifdef USE_MAVLINK_COMPRESSION
+    unpacker_link_in.Init();
+#endif
+#ifdef USE_MAVLINK_PARAM_CACHE
+    serial_in_len = serial_in_pos = serial_in_msg_len = 0;
+    serial_in_released = false;
+    param_check_pending = false;
+    param_list_forward = false;
+#endif
     if (!serialport) return; // should not happen
 
     serialport->flush();
@@ -178,6 +318,7 @@ void MavlinkBase::handle_msg_serial_out(void)
         if (payload.autopilot != MAV_AUTOPILOT_INVALID) {
             // this is an autopilot
             vehicle_sysid = msg_serial_out.sysid;
+            vehicle_heartbeat_tlast_ms = millis32();
             vehicle_is_armed = (payload.base_mode & MAV_MODE_FLAG_SAFETY_ARMED) ? 1 : 0;
 
             // ArduPilot provides flight mode number in custom mode
@@ -199,10 +340,157 @@ void MavlinkBase::handle_msg_serial_out(void)
         fmav_msg_extended_sys_state_decode(&payload, &msg_serial_out);
         vehicle_is_flying = (payload.landed_state == MAV_LANDED_STATE_IN_AIR) ? 1 : 0;
         }break;
+#ifdef USE_MAVLINK_PARAM_CACHE
+    case FASTMAVLINK_MSG_ID_PARAM_VALUE:{
+        if ((msg_serial_out.sysid != vehicle_sysid) || (msg_serial_out.compid != MAV_COMP_ID_AUTOPILOT1)) break;
+        fmav_param_value_t payload;
+        fmav_msg_param_value_decode(&payload, &msg_serial_out);
+        if (param_check_pending && paramcache.IsCheckAnswer(&payload)) { // answer to the cache check
+            param_check_pending = false;
+            if (paramcache.Complete() && paramcache.CheckAnswerMatches(&payload)) {
+                param_list_start();
+            } else {
+                param_list_forward = true; // the params have changed
+            }
+        }
+        paramcache.Learn(msg_serial_out.sysid, msg_serial_out.compid, &payload);
+        }break;
+    case FASTMAVLINK_MSG_ID_ATTITUDE:{
+        if ((msg_serial_out.sysid != vehicle_sysid) || (msg_serial_out.compid != MAV_COMP_ID_AUTOPILOT1)) break;
+        fmav_attitude_t payload;
+        fmav_msg_attitude_decode(&payload, &msg_serial_out);
+        if (payload.time_boot_ms < vehicle_time_boot_ms) { // time went backwards, the vehicle has rebooted
+            paramcache.Clear();
+            param_list_index = UINT16_MAX;
+        }
+        vehicle_time_boot_ms = payload.time_boot_ms;
+        }break;
+#endif
     }
 }
 
 
+#ifdef USE_MAVLINK_PARAM_CACHE
+// reads from serial and holds back a message until it is complete, to see if we can serve it locally
+// the data stream is not changed otherwise, except that a param list request is held back and replaced by a check of the cache
+void MavlinkBase::fill_serial_in(void)
+{
+    if (serial_in_released) {
+        if (serial_in_pos < serial_in_len) return; // hand these out first
+        serial_in_len = serial_in_pos = serial_in_msg_len = 0;
+        serial_in_released = false;
+    }
+
+    if (param_list_forward && !serial_in_len) {
+        param_list_forward = false;
+        memcpy(buf_serial_in, param_list_request_buf, param_list_request_len); // forward the original
+        serial_in_len = param_list_request_len;
+        serial_in_released = true;
+        return;
+    }
+
+    while (serialport->available()) {
+        uint8_t c = serialport->getc();
+        buf_serial_in[serial_in_len++] = c;
+
+        if (serial_in_len == 1) {
+            serial_in_tstart_ms = millis32();
+            if ((c != 0xFD) && (c != 0xFE)) { // not a v2 or v1 magic, pass it on
+                serial_in_released = true;
+                return;
+            }
+        } else
+        if ((serial_in_len == 2) && (buf_serial_in[0] == 0xFE)) {
+            serial_in_msg_len = 8 + c; // v1: header 6 + payload + crc 2
+        } else
+        if ((serial_in_len == 3) && (buf_serial_in[0] == 0xFD)) {
+            serial_in_msg_len = 12 + buf_serial_in[1] + ((c & 0x01) ? 13 : 0); // v2: header 10 + payload + crc 2 + signature 13 if signed
+        }
+
+        if (serial_in_msg_len && (serial_in_len >= serial_in_msg_len)) {
+            if (handle_msg_serial_in()) { // served locally, so drop it
+                serial_in_len = serial_in_msg_len = 0;
+                continue;
+            }
+            serial_in_released = true;
+            return;
+        }
+    }
+
+    if (serial_in_len && ((millis32() - serial_in_tstart_ms) > MAVLINK_SERIAL_IN_TMO_MS)) {
+        serial_in_released = true; // don't hold it back any longer
+    }
+}
+
+
+// returns true if the message was served locally
+bool MavlinkBase::handle_msg_serial_in(void)
+{
+    if (!vehicle_sysid || !paramcache.Complete()) return false;
+
+    // signed messages are left to the vehicle, we can't sign the messages we would generate
+    if ((buf_serial_in[0] == 0xFD) && (buf_serial_in[2] & 0x01)) return false;
+
+    // only param requests are of interest, check this before the effort of parsing it
+    uint32_t msgid = (buf_serial_in[0] == 0xFD) ? buf_serial_in[7] + ((uint32_t)buf_serial_in[8] << 8) + ((uint32_t)buf_serial_in[9] << 16) : buf_serial_in[5];
+    if ((msgid != FASTMAVLINK_MSG_ID_PARAM_REQUEST_LIST) && (msgid != FASTMAVLINK_MSG_ID_PARAM_REQUEST_READ)) return false;
+
+    status_serial_in = {};
+    bool ok = false;
+    for (uint16_t i = 0; i < serial_in_len; i++) {
+        ok = fmav_parse_and_check_to_frame_buf(&result_serial_in, _buf, &status_serial_in, buf_serial_in[i]);
+    }
+    if (!ok) return false;
+    fmav_frame_buf_to_msg(&msg_serial_in, &result_serial_in, _buf);
+
+    switch (msg_serial_in.msgid) {
+    case FASTMAVLINK_MSG_ID_PARAM_REQUEST_LIST:{
+        fmav_param_request_list_t payload;
+        fmav_msg_param_request_list_decode(&payload, &msg_serial_in);
+        if (!paramcache.IsFor(payload.target_system, payload.target_component)) return false;
+        if (serial_in_len > sizeof(param_list_request_buf)) return false; // should not happen
+        // the vehicle may have rebooted with other params without us noticing, so we first check with it,
+        // the list is sent from the cache only if the answer confirms it, else the original is forwarded
+        memcpy(param_list_request_buf, buf_serial_in, serial_in_len);
+        param_list_request_len = serial_in_len;
+        param_list_gcs_sysid = msg_serial_in.sysid;
+        param_list_gcs_compid = msg_serial_in.compid;
+        param_list_target_sysid = payload.target_system;
+        param_list_target_compid = payload.target_component;
+        param_list_index = UINT16_MAX;
+        param_check_pending = true;
+        param_check_tstart_ms = millis32();
+        generate_param_request_read(); // replaces the message
+        serial_in_len = fmav_msg_to_frame_buf(buf_serial_in, &msg_serial_in);
+        }return false;
+
+    case FASTMAVLINK_MSG_ID_PARAM_REQUEST_READ:{
+        fmav_param_request_read_t payload;
+        fmav_msg_param_request_read_decode(&payload, &msg_serial_in);
+        if (!paramcache.IsFor(payload.target_system, payload.target_component)) return false;
+        uint16_t index = (payload.param_index >= 0) ? payload.param_index : paramcache.Find(payload.param_id);
+        if (index >= paramcache.Count()) return false; // not known, let the vehicle respond
+        generate_param_value(index);
+        send_msg_serial_out();
+        paramcache.served_read_cnt++;
+        }return true;
+    }
+
+    return false;
+}
+
+
+void MavlinkBase::param_list_start(void)
+{
+    // send at most half of the serial bandwidth, the rest is for the telemetry from the vehicle
+    param_list_interval_ms = (2 * 37 * 10 * 1000) / Config.SerialBaudrate + 1; // v2 PARAM_VALUE is 37 bytes
+    param_list_tlast_ms = millis32() - param_list_interval_ms;
+    param_list_index = 0;
+    paramcache.served_list_cnt++;
+}
+#endif
+
+
 //-------------------------------------------------------
 // Generate Messages
 //-------------------------------------------------------
@@ -219,8 +507,13 @@ uint8_t rssi, remrssi, txbuf, noise;
     int16_t snr = -stats.GetLastSnr() + 10;
     noise = (snr < 0) ? 0 : (snr > 127) ? 127 : snr;
 
+#ifdef USE_MAVLINK_UPLINK_FLOW_CONTROL
+    // free space in the fifo which holds the data from the GCS, as SiK does
+    txbuf = uplinkflow.Txbuf();
+#else
     // we do nothing, I'm not aware that any GCS respect this, and if so, it needs detailed investigation
     txbuf = 100;
+#endif
 
     fmav_msg_radio_status_pack(
         &msg_serial_out,
@@ -232,4 +525,40 @@ uint8_t rssi, remrssi, txbuf, noise;
 }
 
 
+#ifdef USE_MAVLINK_PARAM_CACHE
+void MavlinkBase::generate_param_value(uint16_t index)
+{
+fmav_param_value_t payload;
+
+    paramcache.Get(index, &payload);
+
+    fmav_msg_param_value_pack(
+        &msg_serial_out,
+        paramcache.sysid, paramcache.compid, // as if it is coming from the autopilot
+        payload.param_id, payload.param_value, payload.param_type, payload.param_count, payload.param_index,
+        //const char* param_id, float param_value, uint8_t param_type, uint16_t param_count, uint16_t param_index,
+        &status_serial_out);
+}
+
+
+// as if it is coming from the GCS, with the GCS's sequence number
+void MavlinkBase::generate_param_request_read(void)
+{
+char param_id[16];
+int16_t param_index;
+
+    paramcache.GetCheckRequest(param_id, &param_index);
+
+    status_serial_in.tx_seq = msg_serial_in.seq;
+
+    fmav_msg_param_request_read_pack(
+        &msg_serial_in,
+        param_list_gcs_sysid, param_list_gcs_compid,
+        param_list_target_sysid, param_list_target_compid, param_id, param_index,
+        //uint8_t target_system, uint8_t target_component, const char* param_id, int16_t param_index,
+        &status_serial_in);
+}
+#endif
+
+
 #endif // MAVLINK_INTERFACE_TX_H
@@ -0,0 +1,234 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// MAVLink Parameter Cache for Transmitter
+//********************************************************
+#ifndef MAVLINK_PARAM_CACHE_H
+#define MAVLINK_PARAM_CACHE_H
+#pragma once
+
+
+#include <inttypes.h>
+#include <string.h>
+
+
+//-------------------------------------------------------
+// MAVLink Parameter Cache
+//-------------------------------------------------------
+// the Tx learns the PARAM_VALUE messages of the autopilot as they stream through, so that repeated
+// PARAM_REQUEST_LIST and PARAM_REQUEST_READ of the GCS can be answered locally
+// - the cache is keyed by the vehicle's sysid, compid and param count, and every update is checked
+//   against the stored param id, a mismatch means that the param set has changed and the cache is cleared
+// - the autopilot sends a PARAM_VALUE for each param change, so the cache follows changes without
+//   any extra traffic over the link
+// - it is cleared when the vehicle's heartbeat is lost, or its time_boot_ms goes backwards, since the
+//   vehicle has rebooted then
+// - requests are served locally only when all params have been received
+// - a param list request is first checked with a PARAM_REQUEST_READ to the vehicle, the list is sent
+//   from the cache only if the answer matches, else the original param list request is forwarded
+//   - PX4 provides the param _HASH_CHECK, a hash over the params, which it also sends at the end of a
+//     param list, so if it was seen it is requested and compared
+//   - ArduPilot doesn't have such, so the last param is requested, and its param count, id and value are
+//     compared, this detects a changed param count or param set, but not a changed value of another param,
+//     which was done while the Tx didn't see the vehicle's PARAM_VALUE, e.g. when the link was lost
+// - requests to all components are also served locally, other components then don't get them
+// - signed messages are not touched, since the Tx can't sign the messages it would generate
+// - the hash over the param ids identifies the param set, it is shown with "pcache" in the CLI
+//
+// the entries are stored in a pool with variable length, to keep RAM usage low
+//   uint8 id length, uint8 param type, float value, id chars without terminating zero
+
+#define MAVLINK_PARAM_CACHE_NUM           1200 // max number of params
+#define MAVLINK_PARAM_CACHE_POOL_SIZE     (MAVLINK_PARAM_CACHE_NUM * 15) // ArduPilot param ids are ca 9 chars on average
+#define MAVLINK_PARAM_CACHE_EMPTY         UINT16_MAX
+#define MAVLINK_PARAM_CACHE_HASH_CHECK_ID "_HASH_CHECK" // PX4
+
+// the cache needs ca 20 kB RAM, which the Tx targets with 32 kB RAM or less can't afford
+// the header is always included, so check only if the option is set
+#if defined USE_MAVLINK_PARAM_CACHE && (defined STM32F070xB || defined STM32F103xB || defined STM32G431xx)
+  #error USE_MAVLINK_PARAM_CACHE needs too much RAM for this target !
+#endif
+
+
+class tMavlinkParamCache
+{
+  public:
+    void Init(void)
+    {
+        Clear();
+        served_list_cnt = 0;
+        served_read_cnt = 0;
+    }
+
+    void Clear(void)
+    {
+        sysid = 0;
+        compid = 0;
+        count = 0;
+        received = 0;
+        pool_len = 0;
+        overflow = false;
+        vehicle_hash_valid = false;
+        for (uint16_t i = 0; i < MAVLINK_PARAM_CACHE_NUM; i++) offset[i] = MAVLINK_PARAM_CACHE_EMPTY;
+    }
+
+    // called for each PARAM_VALUE of the autopilot
+    void Learn(uint8_t _sysid, uint8_t _compid, fmav_param_value_t* payload)
+    {
+        if (_sysid != sysid || _compid != compid || payload->param_count != count) {
+            Clear();
+            sysid = _sysid;
+            compid = _compid;
+            count = payload->param_count;
+        }
+        if (is_hash_check(payload)) {
+            memcpy(&vehicle_hash, &(payload->param_value), 4);
+            vehicle_hash_valid = true;
+            return;
+        }
+        if (count > MAVLINK_PARAM_CACHE_NUM) { overflow = true; return; }
+
+        uint8_t id_len = strnlen(payload->param_id, 16);
+        uint16_t index = payload->param_index;
+        if (index >= count) { // ArduPilot sends param changes with index -1
+            index = Find(payload->param_id);
+            if (index >= count) return;
+        }
+
+        if (offset[index] == MAVLINK_PARAM_CACHE_EMPTY) {
+            if (pool_len + 6 + id_len > MAVLINK_PARAM_CACHE_POOL_SIZE) { overflow = true; return; }
+            offset[index] = pool_len;
+            uint8_t* entry = pool + pool_len;
+            entry[0] = id_len;
+            memcpy(entry + 6, payload->param_id, id_len);
+            pool_len += 6 + id_len;
+            received++;
+        }
+
+        uint8_t* entry = pool + offset[index];
+        if (entry[0] != id_len || memcmp(entry + 6, payload->param_id, id_len)) {
+            Clear(); // param set has changed
+            return;
+        }
+        entry[1] = payload->param_type;
+        memcpy(entry + 2, &(payload->param_value), 4);
+    }
+
+    bool Complete(void)
+    {
+        return (count && received >= count && !overflow);
+    }
+
+    // fills in the param id and index for the PARAM_REQUEST_READ which checks if the cache is still valid
+    void GetCheckRequest(char* param_id, int16_t* param_index)
+    {
+        memset(param_id, 0, 16);
+        if (vehicle_hash_valid) {
+            strncpy(param_id, MAVLINK_PARAM_CACHE_HASH_CHECK_ID, 16);
+            *param_index = -1;
+        } else {
+            *param_index = count - 1;
+        }
+    }
+
+    // returns true if the PARAM_VALUE is the answer to the check request
+    bool IsCheckAnswer(fmav_param_value_t* payload)
+    {
+        if (vehicle_hash_valid) return is_hash_check(payload);
+        return (payload->param_index == count - 1);
+    }
+
+    // must be called before Learn(), which would adopt the answer
+    bool CheckAnswerMatches(fmav_param_value_t* payload)
+    {
+        if (payload->param_count != count) return false;
+        if (vehicle_hash_valid) return !memcmp(&vehicle_hash, &(payload->param_value), 4);
+
+        uint16_t index = payload->param_index;
+        if (index >= count || offset[index] == MAVLINK_PARAM_CACHE_EMPTY) return false;
+        uint8_t* entry = pool + offset[index];
+        uint8_t id_len = strnlen(payload->param_id, 16);
+        if (entry[0] != id_len || memcmp(entry + 6, payload->param_id, id_len)) return false;
+        return !memcmp(entry + 2, &(payload->param_value), 4);
+    }
+
+    bool IsFor(uint8_t target_sysid, uint8_t target_compid)
+    {
+        return (target_sysid == sysid && (target_compid == compid || target_compid == MAV_COMP_ID_ALL));
+    }
+
+    // fills in the param at index, returns false if not available
+    bool Get(uint16_t index, fmav_param_value_t* payload)
+    {
+        if (index >= count || offset[index] == MAVLINK_PARAM_CACHE_EMPTY) return false;
+
+        uint8_t* entry = pool + offset[index];
+        memset(payload->param_id, 0, 16);
+        memcpy(payload->param_id, entry + 6, entry[0]);
+        payload->param_type = entry[1];
+        memcpy(&(payload->param_value), entry + 2, 4);
+        payload->param_count = count;
+        payload->param_index = index;
+        return true;
+    }
+
+    // returns the index of the param, or UINT16_MAX if not found
+    uint16_t Find(const char* param_id)
+    {
+        uint8_t id_len = strnlen(param_id, 16);
+        for (uint16_t i = 0; i < count && i < MAVLINK_PARAM_CACHE_NUM; i++) {
+            if (offset[i] == MAVLINK_PARAM_CACHE_EMPTY) continue;
+            uint8_t* entry = pool + offset[i];
+            if (entry[0] == id_len && !memcmp(entry + 6, param_id, id_len)) return i;
+        }
+        return UINT16_MAX;
+    }
+
+    // FNV-1a over the param ids and types in index order
+    uint32_t Hash(void)
+    {
+        uint32_t hash = 2166136261;
+        for (uint16_t i = 0; i < count && i < MAVLINK_PARAM_CACHE_NUM; i++) {
+            if (offset[i] == MAVLINK_PARAM_CACHE_EMPTY) continue;
+            uint8_t* entry = pool + offset[i];
+            for (uint8_t n = 0; n < entry[0] + 2; n++) { // id length, type, and id chars after value
+                hash ^= (n < 2) ? entry[n] : entry[n + 4];
+                hash *= 16777619;
+            }
+        }
+        return hash;
+    }
+
+    uint16_t Count(void) { return count; }
+    uint16_t Received(void) { return received; }
+    uint16_t PoolUsed(void) { return pool_len; }
+    bool Overflow(void) { return overflow; }
+
+    uint8_t sysid;
+    uint8_t compid;
+
+    uint16_t served_list_cnt;
+    uint16_t served_read_cnt;
+
+  private:
+    bool is_hash_check(fmav_param_value_t* payload)
+    {
+        return !strncmp(payload->param_id, MAVLINK_PARAM_CACHE_HASH_CHECK_ID, 16);
+    }
+
+    uint16_t count;
+    uint16_t received;
+    bool overflow;
+    uint32_t vehicle_hash; // PX4's _HASH_CHECK
+    bool vehicle_hash_valid;
+
+    uint16_t offset[MAVLINK_PARAM_CACHE_NUM];
+    uint8_t pool[MAVLINK_PARAM_CACHE_POOL_SIZE];
+    uint16_t pool_len;
+};
+
+
+#endif // MAVLINK_PARAM_CACHE_H
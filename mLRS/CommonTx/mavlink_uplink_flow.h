@@ -0,0 +1,85 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// MAVLink Uplink Flow Control for Transmitter
+//********************************************************
+#ifndef MAVLINK_UPLINK_FLOW_H
+#define MAVLINK_UPLINK_FLOW_H
+#pragma once
+
+
+#include <inttypes.h>
+
+
+//-------------------------------------------------------
+// MAVLink Uplink Flow Control
+//-------------------------------------------------------
+// the Tx reports the fill level of the fifo which holds the data from the GCS for the link, i.e. of the
+// serial, mbridge or serial2 rx buffer, in the txbuf field of RADIO_STATUS
+// - txbuf is the free space in percent, as with SiK radios
+// - RADIO_STATUS is send once per sec, and with 10 Hz when the fifo is filling up, so that a GCS which
+//   respects txbuf can react before the fifo overflows
+// - the max fill level and the number of times the fifo was found full are recorded, for mbridge also the
+//   bytes lost, view with "uplink" in the CLI
+// the uart drivers drop bytes silently when their buffer is full, so for serial and serial2 we can only
+// tell that bytes may have been lost
+// RADIO_LINK_FLOW_CONTROL is not send, since it is not used by GCSes, and the uarts have no RTS/CTS
+
+#define MAVLINK_UPLINK_FAST_FILL_PCT      25 // RADIO_STATUS is send with 10 Hz above this fill level
+
+
+class tMavlinkUplinkFlow
+{
+  public:
+    void Init(uint16_t _size)
+    {
+        size = _size;
+        fill = 0;
+        fill_max = 0;
+        full = false;
+        full_cnt = 0;
+        lost_cnt = 0;
+    }
+
+    // called each loop, _fill is the number of bytes in the fifo
+    void Update(uint16_t _fill)
+    {
+        fill = _fill;
+        if (fill > fill_max) fill_max = fill;
+
+        if (fill >= size - 1) { // the fifo can hold size - 1 bytes
+            if (!full) full_cnt++;
+            full = true;
+        } else {
+            full = false;
+        }
+    }
+
+    // free space in percent
+    uint8_t Txbuf(void)
+    {
+        if (fill >= size - 1) return 0;
+        return ((uint32_t)(size - 1 - fill) * 100) / (size - 1);
+    }
+
+    // RADIO_STATUS interval
+    uint16_t Interval_ms(void)
+    {
+        return ((uint32_t)fill * 100 > (uint32_t)size * MAVLINK_UPLINK_FAST_FILL_PCT) ? 100 : 1000;
+    }
+
+    uint16_t size;
+    uint16_t fill;
+    uint16_t fill_max;
+    uint16_t full_cnt; // number of times the fifo was found full
+    uint16_t lost_cnt; // number of bytes lost, only for mbridge
+
+  private:
+    bool full;
+};
+
+
+#endif // MAVLINK_UPLINK_FLOW_H
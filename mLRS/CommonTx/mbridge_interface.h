@@ -77,15 +77,17 @@ class tMBridge : public tPin5BridgeBase, public tSerialBase
     bool available(void) { return rx_fifo.Available(); }
     char getc(void) { return rx_fifo.Get(); }
     void flush(void) { rx_fifo.Flush(); }
+    uint16_t bytes_available(void) { return rx_fifo.Available(); }
 
     // backend
     // fills/reads the fifo's with the mBridge uart
-    void serial_putc(char c) { rx_fifo.Put(c); }
+    void serial_putc(char c) { if (!rx_fifo.Put(c)) serial_rx_overflow_cnt++; }
     bool serial_rx_available(void) { return tx_fifo.Available(); }
     char serial_getc(void) { return tx_fifo.Get(); }
 
     FifoBase<char,TX_MBRIDGE_TXBUFSIZE> tx_fifo;
     FifoBase<char,TX_MBRIDGE_RXBUFSIZE> rx_fifo;
+    volatile uint16_t serial_rx_overflow_cnt; // bytes lost since rx_fifo was full
 
     // for communication
     FifoBase<uint8_t,128> cmd_fifo;
@@ -139,12 +141,8 @@ uint8_t tMBridge::send_serial(void)
 {
 if (crsf_emulation) return false; // CRSF: just don't ever do it
 
-    uint8_t count = 0;
     uint8_t payload[MBRIDGE_M2R_SERIAL_PAYLOAD_LEN_MAX];
-    for (uint8_t i = 0; i < MBRIDGE_M2R_SERIAL_PAYLOAD_LEN_MAX; i++) {
-        if (!serial_rx_available()) break;
-        payload[count++] = serial_getc();
-    }
+    uint8_t count = tx_fifo.GetBuf(payload, MBRIDGE_M2R_SERIAL_PAYLOAD_LEN_MAX);
     if (count > 0) {
         pin5_putc(0x00); // we can send anything we want which is not a command, send 0xoo so it is easy to recognize
         for (uint8_t i = 0; i < count; i++) {
@@ -326,6 +324,7 @@ void tMBridge::Init(bool enable_flag, bool crsf_emulation_flag)
 
     tx_fifo.Init();
     rx_fifo.Init();
+    serial_rx_overflow_cnt = 0;
 
     cmd_fifo.Init();
     cmd_in_process = 0;
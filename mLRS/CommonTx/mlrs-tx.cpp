@@ -80,6 +80,9 @@ v0.0.00:
 
 #include "in.h"
 #include "txstats.h"
+#include "blackbox.h"
+#include "mavlink_param_cache.h"
+#include "mavlink_uplink_flow.h"
 #include "config_id.h"
 #include "cli.h"
 #include "mbridge_interface.h" // this includes uart.h as it needs callbacks, declares tMBridge mbridge
@@ -87,6 +90,15 @@ v0.0.00:
 
 
 TxStatsBase txstats;
+#ifdef USE_BLACKBOX
+tBlackBox bbox;
+#endif
+#ifdef USE_MAVLINK_PARAM_CACHE
+tMavlinkParamCache paramcache;
+#endif
+#ifdef USE_MAVLINK_UPLINK_FLOW_CONTROL
+tMavlinkUplinkFlow uplinkflow;
+#endif
 tComPort com;
 tTxCli cli;
 ChannelOrder channelOrder(ChannelOrder::DIRECTION_TX_TO_MLRS);
@@ -177,6 +189,9 @@ class WhileTransmit : public WhileBase
   public:
     int32_t dtmax_us(void) override { return sx.TimeOverAir_us() - 1000; }
     void handle_once(void) override;
+#ifdef USE_PROFILER
+    void overrun(int32_t dt_us) override { profiler.Overrun(dt_us); }
+#endif
 };
 
 WhileTransmit whileTransmit;
@@ -237,6 +252,27 @@ void enter_flash_esp(void)
 }
 
 
+// apply changed parameters while running, only for those which don't need a restart
+void params_apply_live(void)
+{
+    setup_configure_live_config(Config.ConfigId);
+
+    if (Setup.Tx[Config.ConfigId].SerialBaudrate != SetupInUse_Tx.SerialBaudrate) {
+        serial.SetBaudRate(Config.SerialBaudrate);
+        serial2.SetBaudRate(Config.SerialBaudrate);
+    }
+    in.Configure(Setup.Tx[Config.ConfigId].InMode); // does nothing if not changed
+    if (Setup.Tx[Config.ConfigId].Power != SetupInUse_Tx.Power) {
+        powerctrl.Init(Config.Power_dbm, rfpower_list[0].dbm, Config.frame_rate_ms);
+        sx.SetRfPower_dbm(powerctrl.Power_dbm());
+        sx2.SetRfPower_dbm(powerctrl.Power_dbm());
+        fan.SetPower(sx.RfPower_dbm());
+    }
+
+    setup_set_in_use();
+}
+
+
 //-------------------------------------------------------
 // Init
 //-------------------------------------------------------
@@ -292,10 +328,13 @@ void init(void)
 
 volatile uint16_t irq_status;
 volatile uint16_t irq2_status;
+volatile uint16_t irq_rx_done_us; // time stamp of the dio edge, is taken first thing in the isr
+volatile uint16_t irq2_rx_done_us;
 
 IRQHANDLER(
 void SX_DIO_EXTI_IRQHandler(void)
 {
+    irq_rx_done_us = micros();
     sx_dio_exti_isr_clearflag();
     irq_status = sx.GetAndClearIrqStatus(SX12xx_IRQ_ALL);
     if (irq_status & SX12xx_IRQ_RX_DONE) {
@@ -314,6 +353,7 @@ void SX_DIO_EXTI_IRQHandler(void)
 IRQHANDLER(
 void SX2_DIO_EXTI_IRQHandler(void)
 {
+    irq2_rx_done_us = micros();
     sx2_dio_exti_isr_clearflag();
     irq2_status = sx2.GetAndClearIrqStatus(SX12xx_IRQ_ALL);
     if (irq2_status & SX12xx_IRQ_RX_DONE) {
@@ -341,6 +381,12 @@ uint8_t link_task;
 uint8_t transmit_frame_type;
 uint16_t link_task_delay_ms;
 bool doParamsStore;
+bool doParamsStoreEEPROM;
+uint8_t fhss_swap_i;
+uint8_t fhss_swap_ch;
+uint8_t mode_switch_mode;
+uint8_t mode_switch_cnt;
+bool mode_switch_acked;
 
 
 void link_task_init(void)
@@ -350,6 +396,7 @@ void link_task_init(void)
     transmit_frame_type = TRANSMIT_FRAME_TYPE_NORMAL;
 
     doParamsStore = false;
+    doParamsStoreEEPROM = false;
 }
 
 
@@ -416,7 +463,29 @@ tCmdFrameHeader* head = (tCmdFrameHeader*)(frame->payload);
         }
         mbridge.Unlock();
 #endif
+        fhss.ResetSwaps(); // the Rx has reset its list too
         break;
+    case FRAME_CMD_FHSS_SWAP_ACK: {
+        tCmdFrameFhssSwap* fhss_swap = (tCmdFrameFhssSwap*)(frame->payload);
+        if (link_task != LINK_TASK_TX_FHSS_SWAP) break; // is a repeated ack
+        if (fhss_swap->fhss_i != fhss_swap_i || fhss_swap->ch != fhss_swap_ch) break; // should not happen
+        link_task_reset(); // the swap itself is done in HopToNext()
+        }break;
+    case FRAME_CMD_RX_POWER:
+        unpack_rxcmdframe_rxpower(frame);
+        break;
+    case FRAME_CMD_RX_RC_LATENCY: {
+        tRxCmdFrameRcLatency rc_latency;
+        unpack_rxcmdframe_rclatency(frame, &rc_latency);
+        rclatency.SetReport(&rc_latency);
+        }break;
+    case FRAME_CMD_MODE_SWITCH_ACK: {
+        tCmdFrameModeSwitch* mode_switch = (tCmdFrameModeSwitch*)(frame->payload);
+        if (link_task != LINK_TASK_TX_MODE_SWITCH) break; // is a late ack
+        if (mode_switch->mode != mode_switch_mode) break; // should not happen
+        if (mode_switch_cnt < MODE_ADAPTIVE_CONFIRM_CNT_MIN) break; // too late, the Rx may not get the confirmation
+        mode_switch_acked = true; // the following announcements are confirmed, the switch is done when mode_switch_cnt expires
+        }break;
     }
 }
 
@@ -437,10 +506,30 @@ void pack_txcmdframe(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc)
         pack_txcmdframe_cmd(frame, frame_stats, rc, FRAME_CMD_STORE_RX_PARAMS);
         transmit_frame_type = TRANSMIT_FRAME_TYPE_NORMAL;
         break;
+    case LINK_TASK_TX_FHSS_SWAP:
+        pack_txcmdframe_fhssswap(frame, frame_stats, rc, fhss_swap_i, fhss_swap_ch);
+        break;
+    case LINK_TASK_TX_MODE_SWITCH:
+        pack_txcmdframe_modeswitch(frame, frame_stats, rc, mode_switch_mode, mode_switch_cnt, mode_switch_acked);
+        break;
     }
 }
 
 
+// switch mode on the fly, is called before a frame is transmitted
+// the fhss list is kept, so no need to touch fhss
+void link_mode_apply(uint8_t mode)
+{
+    configure_mode(mode);
+    sx.SetToIdle();
+    sx2.SetToIdle();
+    sx.SetLoraConfigurationByIndex(Config.LoraConfigIndex);
+    sx2.SetLoraConfigurationByIndex(Config.LoraConfigIndex);
+
+    txstats.SetPeriod(Config.LQAveragingPeriod);
+}
+
+
 //-- normal Tx, Rx frames handling
 
 void prepare_transmit_frame(uint8_t antenna, uint8_t ack)
@@ -448,16 +537,25 @@ void prepare_transmit_frame(uint8_t antenna, uint8_t ack)
 uint8_t payload[FRAME_TX_PAYLOAD_LEN];
 uint8_t payload_len = 0;
 
+#ifdef USE_ARQ
+    bool resend = (transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL) && arq.PayloadPending();
+    arq.SetTransmitFrameType(transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL);
+
+    if (resend) {
+        // last payload was not acked, so resend it with the same seq no
+        payload_len = arq.GetPayload(payload);
+        stats.retransmit_cnt++;
+    } else
+#endif
     if (transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL) {
+#ifdef USE_ARQ
+        stats.transmit_seq_no++;
+#endif
 
         // read data from serial port
         if (connected()) {
             if (sx_serial.IsEnabled()) {
-                for (uint8_t i = 0; i < FRAME_TX_PAYLOAD_LEN; i++) {
-                    if (!sx_serial.available()) break;
-                    payload[payload_len] = sx_serial.getc();
-                    payload_len++;
-                }
+                payload_len = sx_serial.GetPayload(payload, Config.frame_tx_payload_len);
             }
 
             stats.bytes_transmitted.Add(payload_len);
@@ -465,6 +563,10 @@ uint8_t payload_len = 0;
         } else {
             sx_serial.flush();
         }
+
+#ifdef USE_ARQ
+        arq.SetPayload(payload, payload_len);
+#endif
     }
 
     stats.last_transmit_antenna = antenna;
@@ -477,6 +579,9 @@ uint8_t payload_len = 0;
     frame_stats.rssi = stats.GetLastRssi();
     frame_stats.LQ = txstats.GetLQ();
     frame_stats.LQ_serial_data = txstats.GetLQ_serial_data();
+#ifdef USE_RC_LATENCY
+    frame_stats.LQ_serial_data = rclatency.AgeMarker(micros(), millis32()); // the Rx doesn't use LQ_serial_data
+#endif
 
     if (transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL) {
         pack_txframe(&txFrame, &frame_stats, &rcData, payload, payload_len);
@@ -497,10 +602,18 @@ void process_received_frame(bool do_payload, tRxFrame* frame)
     if (!do_payload) return;
 
     if (frame->status.frame_type == FRAME_TYPE_TX_RX_CMD) {
+        if (!rxcmdframe_complete(frame)) return; // slim frames, wait for all chunks
         process_received_rxcmdframe(frame);
         return;
     }
 
+    cmd_chunker.Reset();
+
+#ifdef USE_ARQ
+    // a retransmission of a payload we already got
+    if (!arq.AcceptPayload(frame->status.seq_no)) return;
+#endif
+
     // output data on serial
     if (sx_serial.IsEnabled()) {
         for (uint8_t i = 0; i < frame->status.payload_len; i++) {
@@ -543,10 +656,16 @@ tRxFrame* frame;
 
         stats.received_seq_no = frame->status.seq_no;
         stats.received_ack = frame->status.ack;
+#ifdef USE_ARQ
+        arq.SetReceived(true);
+#endif
 
     } else { // RX_STATUS_INVALID
         stats.received_seq_no = UINT8_MAX;
         stats.received_ack = 0;
+#ifdef USE_ARQ
+        arq.SetReceived(false);
+#endif
     }
 
     // we set it for all received frames
@@ -561,29 +680,44 @@ void handle_receive_none(void) // RX_STATUS_NONE
 {
     stats.received_seq_no = UINT8_MAX;
     stats.received_ack = 0;
+#ifdef USE_ARQ
+    arq.SetReceived(false);
+#endif
 }
 
 
 void do_transmit(uint8_t antenna) // we send a TX frame to receiver
 {
 uint8_t ack = 1;
+uint8_t len;
 
     if (bind.IsInBind()) {
         bind.do_transmit(antenna);
         return;
     }
 
+#ifdef USE_ARQ
+    arq.HandleAck(stats.received_ack);
+    ack = arq.Ack();
+#else
     stats.transmit_seq_no++;
+#endif
 
     prepare_transmit_frame(antenna, ack);
 
-    sxSendFrame(antenna, &txFrame, FRAME_TX_RX_LEN, SEND_FRAME_TMO_MS); // 10 ms tmo
+    len = txframe_shrink(&txFrame);
+
+    sxSendFrame(antenna, &txFrame, len, SEND_FRAME_TMO_MS); // 10 ms tmo
+#ifdef USE_BLACKBOX
+    bbox.Transmit(micros());
+#endif
 }
 
 
 uint8_t do_receive(uint8_t antenna) // we receive a RX frame from receiver
 {
 uint8_t res;
+uint8_t len;
 uint8_t rx_status = RX_STATUS_INVALID; // this also signals that a frame was received
 
     if (bind.IsInBind()) {
@@ -592,7 +726,10 @@ uint8_t rx_status = RX_STATUS_INVALID; // this also signals that a frame was rec
 
     // we don't need to read sx.GetRxBufferStatus(), but hey
     // we could save 2 byte's time by not reading sync_word again, but hey
-    sxReadFrame(antenna, &rxFrame, &rxFrame2, FRAME_TX_RX_LEN);
+    len = sxReadFrame(antenna, &rxFrame, &rxFrame2, Config.frame_len);
+
+    if (!rxframe_expand((antenna == ANTENNA_1) ? &rxFrame : &rxFrame2, len)) return RX_STATUS_INVALID;
+
     res = (antenna == ANTENNA_1) ? check_rxframe(&rxFrame) : check_rxframe(&rxFrame2);
 
     if (res) {
@@ -606,6 +743,11 @@ uint8_t rx_status = RX_STATUS_INVALID; // this also signals that a frame was rec
         rx_status = RX_STATUS_VALID;
     }
 
+#ifdef USE_BLACKBOX
+    bbox.Received(antenna, res, (antenna == ANTENNA_1) ? rxFrame.status.payload_len : rxFrame2.status.payload_len,
+                  (antenna == ANTENNA_1) ? irq_rx_done_us : irq2_rx_done_us);
+#endif
+
     // we want to have the rssi,snr stats even if it's a bad packet
     sxGetPacketStatus(antenna, &stats);
 
@@ -685,11 +827,22 @@ RESTARTCONTROLLER:
   link_task_set(LINK_TASK_TX_GET_RX_SETUPDATA); // we start with wanting to get rx setup data
 
   txstats.Init(Config.LQAveragingPeriod);
+#ifdef USE_BLACKBOX
+  bbox.Init();
+#endif
+#ifdef USE_ARQ
+  arq.Init();
+#endif
+  cmd_chunker.Init();
+  rclatency.Init();
 
   in.Configure(Setup.Tx[Config.ConfigId].InMode);
   mavlink.Init();
   sx_serial.Init(&serial, &mbridge, &serial2);
   fan.SetPower(sx.RfPower_dbm());
+  powerctrl.Init(Config.Power_dbm, rfpower_list[0].dbm, Config.frame_rate_ms);
+  modeadapt.Init(Config.Mode);
+  mode_switch_cnt = 0;
   whileTransmit.Init();
 
   disp.Init();
@@ -700,7 +853,11 @@ RESTARTCONTROLLER:
   tick_1hz = 0;
   tick_1hz_commensurate = 0;
   doSysTask = 0; // helps in avoiding too short first loop
+#ifdef USE_PROFILER
+  profiler.Init();
+#endif
   while (1) {
+    PROFILE_LOOP();
 
     //-- SysTask handling
 
@@ -708,6 +865,7 @@ RESTARTCONTROLLER:
         // when we do long tasks, like display transfer, we miss ticks, so we need to catch up
         // the commands below must not be sensitive to strict ms timing
         doSysTask--; // doSysTask = 0;
+        PROFILE_START(PROFILE_SYSTASK);
 
         if (connect_tmo_cnt) {
             connect_tmo_cnt--;
@@ -768,10 +926,12 @@ RESTARTCONTROLLER:
             dbg.puts(u16toBCD_s(stats.bytes_transmitted.GetBytesPerSec())); dbg.puts(", ");
             dbg.puts(u16toBCD_s(stats.bytes_received.GetBytesPerSec())); dbg.puts("; "); */
         }
+        PROFILE_END(PROFILE_SYSTASK);
     }
 
     //-- SX handling
 
+    PROFILE_START(PROFILE_SX);
     switch (link_state) {
     case LINK_STATE_IDLE:
     case LINK_STATE_RECEIVE_DONE:
@@ -863,10 +1023,19 @@ IF_ANTENNA2(
         }
     }//end of if(irq2_status)
 );
+    PROFILE_END(PROFILE_SX);
+
+    // write the flash right after a transmission, the cpu stalls for a while, which costs the
+    // frame to be received but doesn't delay a transmission
+    if (doParamsStoreEEPROM && (link_state == LINK_STATE_RECEIVE)) {
+        doParamsStoreEEPROM = false;
+        setup_store_to_EEPROM();
+    }
 
     // this happens before switching to transmit, i.e. after a frame was or should have been received
     if (doPreTransmit) {
         doPreTransmit = false;
+        PROFILE_START(PROFILE_FRAME);
 
         bool frame_received = false;
         bool valid_frame_received = false;
@@ -917,6 +1086,11 @@ IF_ANTENNA2(
         txstats.fhss_curr_i = fhss.CurrI();
         txstats.rx1_valid = (link_rx1_status > RX_STATUS_INVALID);
         txstats.rx2_valid = (link_rx2_status > RX_STATUS_INVALID);
+#ifdef USE_BLACKBOX
+        if (!bind.IsInBind()) {
+            bbox.Add(fhss.CurrI(), link_rx1_status, link_rx2_status, stats.last_antenna, connected());
+        }
+#endif
 
         if (valid_frame_received) { // valid frame received
             switch (connect_state) {
@@ -953,6 +1127,12 @@ IF_ANTENNA2(
             // so disconnect
             connect_state = CONNECT_STATE_LISTEN;
             // link_state will be set to LINK_STATE_TRANSMIT below
+#ifdef USE_MODE_ADAPTIVE
+            // fall back to the setup mode, the Rx does the same
+            mode_switch_cnt = 0;
+            modeadapt.Reset();
+            if (Config.Mode != modeadapt.ModeBase() && !bind.IsInBind()) link_mode_apply(modeadapt.ModeBase());
+#endif
         }
 
         // we are connected but didn't receive a valid frame
@@ -975,7 +1155,58 @@ IF_ANTENNA2(
             txstats.Update1Hz();
         }
         txstats.Next();
-        if (!connected()) txstats.Clear();
+        if (!connected()) {
+            txstats.Clear();
+#ifdef USE_ARQ
+            arq.Reset();
+#endif
+        }
+
+#ifdef USE_FHSS_ADAPTIVE
+        if (connected()) fhss.SetHopStats(valid_frame_received, stats.GetLastRssi());
+#endif
+        if (!connected()) fhss.ResetSwaps(); // ensures both sides use the same list on connect
+#ifdef USE_FHSS_ADAPTIVE
+        if ((link_task == LINK_TASK_TX_FHSS_SWAP) && !fhss.ChannelSwapPending()) {
+            link_task_reset(); // swap is done, no ack was received, but the Rx most likely got one of the cmds
+        }
+        if (connected() && (link_task == LINK_TASK_NONE) && !fhss.ChannelSwapPending() &&
+            fhss.GetChannelSwap(&fhss_swap_i, &fhss_swap_ch)) {
+            fhss.SetChannelSwap(fhss_swap_i, fhss_swap_ch);
+            link_task_set(LINK_TASK_TX_FHSS_SWAP);
+        }
+#endif
+#ifdef USE_MODE_ADAPTIVE
+        if (mode_switch_cnt) {
+            mode_switch_cnt--;
+            if (!mode_switch_cnt) {
+                // the Rx switches right before receiving this frame, if it got a confirmed announcement
+                // if we didn't get an ack we don't switch, and the Rx doesn't either
+                if (mode_switch_acked) link_mode_apply(mode_switch_mode);
+                if (link_task == LINK_TASK_TX_MODE_SWITCH) link_task_reset();
+            }
+        }
+        if (connected() && modeadapt.Enabled() && !tick_1hz_commensurate && (link_task == LINK_TASK_NONE) && !mode_switch_cnt) {
+            uint8_t LQ = (stats.received_LQ < txstats.GetLQ()) ? stats.received_LQ : txstats.GetLQ();
+            int8_t rssi = (stats.received_rssi < stats.GetLastRssi()) ? stats.received_rssi : stats.GetLastRssi();
+            int16_t margin = (rssi == RSSI_INVALID) ? 0 : (int16_t)rssi - sx.ReceiverSensitivity_dbm();
+            uint8_t mode = modeadapt.Update1Hz(Config.Mode, LQ, margin);
+            if (mode != Config.Mode) {
+                mode_switch_mode = mode;
+                mode_switch_cnt = MODE_ADAPTIVE_SWITCH_CNT;
+                mode_switch_acked = false;
+                link_task_set(LINK_TASK_TX_MODE_SWITCH);
+            }
+        }
+#endif
+#ifdef USE_DYNAMIC_POWER
+        if (connected() ? powerctrl.Update(valid_frame_received, stats.received_rssi, sx.ReceiverSensitivity_dbm()) :
+                          powerctrl.Reset()) {
+            sx.SetRfPower_dbm(powerctrl.Power_dbm());
+            sx2.SetRfPower_dbm(powerctrl.Power_dbm());
+            fan.SetPower(sx.RfPower_dbm());
+        }
+#endif
 
         if (Setup.Tx[Config.ConfigId].Buzzer == BUZZER_LOST_PACKETS && connect_occured_once && !bind.IsInBind()) {
             if (!valid_frame_received) buzzer.BeepLP();
@@ -983,10 +1214,15 @@ IF_ANTENNA2(
 
         // store parameters
         if (doParamsStore) {
-            sx.SetToIdle();
-            sx2.SetToIdle();
-            setup_store_to_EEPROM();
-            goto RESTARTCONTROLLER;
+            if (setup_needs_restart()) {
+                sx.SetToIdle();
+                sx2.SetToIdle();
+                setup_store_to_EEPROM();
+                goto RESTARTCONTROLLER;
+            }
+            doParamsStore = false;
+            params_apply_live();
+            doParamsStoreEEPROM = true; // is done after the transmission
         }
 
         bind.Do();
@@ -1003,11 +1239,14 @@ IF_ANTENNA2(
         }
 
 //dbg.puts((valid_frame_received) ? "\nvalid" : "\ninval");
+        PROFILE_END(PROFILE_FRAME);
     }//end of if(doPreTransmit)
 
 
     //-- Update channels, MBridge handling, Crsf handling, In handling, etc
 
+    PROFILE_START(PROFILE_CHANNELS);
+
 #ifdef DEVICE_HAS_JRPIN5
 IF_MBRIDGE(
     // mBridge sends channels in regular 20 ms intervals, this we can use as sync
@@ -1016,6 +1255,9 @@ IF_MBRIDGE(
         if (Setup.Tx[Config.ConfigId].ChannelsSource == CHANNEL_SOURCE_MBRIDGE) {
             channelOrder.Set(Setup.Tx[Config.ConfigId].ChannelOrder); //TODO: better than before, but still better place!?
             channelOrder.Apply(&rcData);
+#ifdef USE_RC_LATENCY
+            rclatency.Ingest(micros(), millis32());
+#endif
         }
         // when we receive channels packet from transmitter, we send link stats to transmitter
         mbridge.TelemetryStart();
@@ -1079,6 +1321,9 @@ IF_CRSF(
         if (Setup.Tx[Config.ConfigId].ChannelsSource == CHANNEL_SOURCE_CRSF) {
             channelOrder.Set(Setup.Tx[Config.ConfigId].ChannelOrder); //TODO: better than before, but still better place!?
             channelOrder.Apply(&rcData);
+#ifdef USE_RC_LATENCY
+            rclatency.Ingest(micros(), millis32());
+#endif
         }
     }
     uint8_t crsftask; uint8_t crsfcmd;
@@ -1123,20 +1368,30 @@ IF_CRSF(
         if (in.Update(&rcData)) {
             channelOrder.Set(Setup.Tx[Config.ConfigId].ChannelOrder); //TODO: better than before, but still better place!?
             channelOrder.Apply(&rcData);
+#ifdef USE_RC_LATENCY
+            rclatency.Ingest(micros(), millis32());
+#endif
         }
     }
 #endif
 
+    PROFILE_END(PROFILE_CHANNELS);
+
     //-- Do mavlink
 
+    PROFILE_START(PROFILE_MAVLINK);
     mavlink.Do();
+    PROFILE_END(PROFILE_MAVLINK);
 
     //-- Do WhileTransmit stuff
 
+    PROFILE_START(PROFILE_WHILE);
     whileTransmit.Do();
+    PROFILE_END(PROFILE_WHILE);
 
     //-- Handle display or cli task
 
+    PROFILE_START(PROFILE_TASKS);
     uint8_t cli_task = disp.Task();
     if (cli_task == CLI_TASK_NONE) cli_task = cli.Task();
 
@@ -1179,6 +1434,7 @@ IF_CRSF(
     if (config_id.Do()) {
         doParamsStore = true;
     }
+    PROFILE_END(PROFILE_TASKS);
 
   }//end of while(1) loop
 
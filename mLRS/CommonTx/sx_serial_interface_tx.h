@@ -20,6 +20,7 @@ class tTxSxSerial : public tSerialBase
     void Init(tSerialBase* _serial, tSerialBase* _mbridge, tSerialBase* _serial2)
     {
         tSerialBase::Init();
+        packer.Init();
 
         switch (Setup.Tx[Config.ConfigId].SerialDestination) {
         case SERIAL_DESTINATION_SERIAL:
@@ -63,6 +64,7 @@ class tTxSxSerial : public tSerialBase
     {
         mavlink.flush(); // we don't distinguish here, can't harm to always flush mavlink handler
         serialport->flush();
+        packer.Flush();
     }
 
     virtual void putc(char c)
@@ -74,6 +76,24 @@ class tTxSxSerial : public tSerialBase
         }
         serialport->putc(c);
     }
+
+    // fills the payload with data from serial, returns the number of bytes
+    uint8_t GetPayload(uint8_t* payload, uint8_t payload_max_len)
+    {
+#ifdef USE_MAVLINK_PACKING
+        if (Setup.Rx.SerialLinkMode == SERIAL_LINK_MODE_MAVLINK) {
+            return packer.GetPayload(this, payload, payload_max_len);
+        }
+#endif
+        uint8_t payload_len = 0;
+        while ((payload_len < payload_max_len) && available()) {
+            payload[payload_len++] = getc();
+        }
+        return payload_len;
+    }
+
+  private:
+    MavlinkPacker packer;
 };
 
 
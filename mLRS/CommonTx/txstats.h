@@ -20,6 +20,7 @@ class TxStatsBase
 {
   public:
     void Init(uint8_t _period);
+    void SetPeriod(uint8_t _period); // called then the frame rate changed
 
     void Update1Hz(void); // called at 1 Hz
     void Next(void); // called at each cycle
@@ -54,6 +55,13 @@ void TxStatsBase::Init(uint8_t _period)
 }
 
 
+void TxStatsBase::SetPeriod(uint8_t _period)
+{
+    LQma_received.ChangePeriod(_period);
+    LQma_valid.ChangePeriod(_period);
+}
+
+
 void TxStatsBase::Update1Hz(void)
 {
     stats.Update1Hz();
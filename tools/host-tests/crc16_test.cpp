@@ -0,0 +1,91 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// crc16 host test
+//*******************************************************
+// checks the table driven crc16 of Common/libs/crc16.h against the bytewise X.25 crc of fastmavlink
+// the reference is a copy of fmav_crc_accumulate(), since the fastmavlink library is generated into
+// Common/mavlink/out only by fmav_generate_c_library.py and is not available to the host tests
+// - random frames with random crc1 split points, as in the Tx/Rx frame pack and check functions
+// - benchmark for a 91 bytes frame
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "Common/libs/crc16.h"
+
+
+#define FRAME_LEN         91
+#define TEST_CNT          100000
+#define BENCH_CNT         200000
+
+
+// as fmav_crc_accumulate(), fmav_crc_init()
+static inline void fmav_crc_accumulate(uint16_t* crc, uint8_t data)
+{
+uint8_t tmp;
+
+    tmp = data ^ (uint8_t)(*crc & 0xff);
+    tmp ^= (tmp << 4);
+    *crc = (*crc >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4);
+}
+
+
+static uint16_t fmav_crc_calculate(const uint8_t* buf, uint16_t len)
+{
+uint16_t crc = 0xFFFF;
+
+    while (len--) fmav_crc_accumulate(&crc, *buf++);
+    return crc;
+}
+
+
+int main(void)
+{
+uint8_t frame[FRAME_LEN];
+uint32_t err_cnt = 0;
+
+    srand(1);
+
+    // check
+    for (uint32_t n = 0; n < TEST_CNT; n++) {
+        for (uint8_t i = 0; i < FRAME_LEN; i++) frame[i] = rand();
+        uint8_t split = rand() % FRAME_LEN;
+
+        uint16_t crc_ref = 0xFFFF;
+        for (uint8_t i = 0; i < split; i++) fmav_crc_accumulate(&crc_ref, frame[i]);
+        uint16_t crc1_ref = crc_ref;
+        for (uint8_t i = split; i < FRAME_LEN; i++) fmav_crc_accumulate(&crc_ref, frame[i]);
+
+        uint16_t crc;
+        crc16_init(&crc);
+        crc16_accumulate_buf(&crc, frame, split);
+        uint16_t crc1 = crc;
+        for (uint8_t i = split; i < FRAME_LEN; i++) crc16_accumulate(&crc, frame[i]);
+
+        if (crc1 != crc1_ref || crc != crc_ref || crc16_calculate(frame, FRAME_LEN) != crc_ref) err_cnt++;
+    }
+    printf("check: %u frames, %u mismatches\n", TEST_CNT, err_cnt);
+
+    // benchmark
+    volatile uint16_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < BENCH_CNT; n++) {
+        frame[0] = n;
+        sink = sink + fmav_crc_calculate(frame, FRAME_LEN);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < BENCH_CNT; n++) {
+        frame[0] = n;
+        sink = sink + crc16_calculate(frame, FRAME_LEN);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double ns_ref = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_CNT;
+    double ns_tab = std::chrono::duration<double, std::nano>(t2 - t1).count() / BENCH_CNT;
+    printf("bench: %u bytes frame, bytewise %.1f ns, table %.1f ns\n", FRAME_LEN, ns_ref, ns_tab);
+
+    return (err_cnt) ? 1 : 0;
+}
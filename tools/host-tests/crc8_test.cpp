@@ -0,0 +1,80 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// crc8 host test
+//*******************************************************
+// checks crc8_calc(), crc8_update() of Common/thirdparty against the bitwise loop
+// is compiled once for each crc8 engine, CRC8_USE_TABLE, CRC8_USE_NIBBLE_TABLE, CRC8_USE_BITWISE
+// - all crc/byte combinations, for the CRSF poly 0xD5 and another poly
+// - benchmark for a 24 bytes CRSF channel frame
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "Common/thirdparty/thirdparty.h"
+
+
+#define FRAME_LEN         24
+#define BENCH_CNT         1000000
+
+
+static uint8_t crc8_ref(uint8_t crc, uint8_t a, uint8_t poly)
+{
+    crc ^= a;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x80) ? (crc << 1) ^ poly : (crc << 1);
+    }
+    return crc;
+}
+
+
+int main(void)
+{
+const uint8_t polys[2] = { 0xD5, 0xBA };
+uint32_t err_cnt = 0;
+
+#if defined CRC8_USE_TABLE
+    const char* engine = "256 bytes table";
+#elif defined CRC8_USE_NIBBLE_TABLE
+    const char* engine = "nibble table";
+#else
+    const char* engine = "bitwise";
+#endif
+
+    // check
+    for (uint8_t p = 0; p < 2; p++) {
+        for (uint16_t crc = 0; crc < 256; crc++) {
+            for (uint16_t a = 0; a < 256; a++) {
+                if (crc8_calc(crc, a, polys[p]) != crc8_ref(crc, a, polys[p])) err_cnt++;
+            }
+        }
+    }
+
+    uint8_t frame[FRAME_LEN];
+    srand(1);
+    for (uint32_t n = 0; n < 10000; n++) {
+        for (uint8_t i = 0; i < FRAME_LEN; i++) frame[i] = rand();
+        for (uint8_t p = 0; p < 2; p++) {
+            uint8_t crc = 0;
+            for (uint8_t i = 0; i < FRAME_LEN; i++) crc = crc8_ref(crc, frame[i], polys[p]);
+            if (crc8_update(0, frame, FRAME_LEN, polys[p]) != crc) err_cnt++;
+        }
+    }
+    printf("check: %s, %u mismatches\n", engine, err_cnt);
+
+    // benchmark
+    volatile uint8_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < BENCH_CNT; n++) {
+        frame[0] = n;
+        sink = sink + crc8_update(0, frame, FRAME_LEN, 0xD5);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_CNT;
+    printf("bench: %s, %u bytes frame, %.1f ns\n", engine, FRAME_LEN, ns);
+
+    return (err_cnt) ? 1 : 0;
+}
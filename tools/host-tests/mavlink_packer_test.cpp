@@ -0,0 +1,164 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// MAVLink packer host test
+//*******************************************************
+// checks the MavlinkPacker of Common/mavlink/fmav_extension.h, as used with USE_MAVLINK_PACKING
+// a random stream of v1, v2 and signed v2 messages and stray bytes is read in bursts, as from the serial,
+// and taken out frame by frame
+// - the bytes which come out must be identical to the bytes which went in
+// - a message which fits into a frame must not be split across two frames
+// - an incomplete message must be handed out after MAVLINK_PACKER_TMO_MS
+// the fastmavlink library is not available to the host tests, so the few types and functions which
+// fmav_extension.h needs are stubbed, the packer doesn't use them
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <vector>
+
+
+static uint32_t tnow_ms = 0;
+
+static uint32_t millis32(void) { return tnow_ms; }
+
+typedef struct {
+    uint8_t len, incompat_flags, compat_flags, seq, sysid, compid, msgid_a[3], crc_extra;
+    uint8_t payload[255];
+    uint16_t checksum;
+} fmav_message_t;
+
+typedef struct {
+    uint32_t msgid;
+    uint8_t crc_extra;
+} fmav_message_entry_t;
+
+static const fmav_message_entry_t* fmav_get_message_entry(uint32_t msgid) { (void)msgid; return NULL; }
+static uint16_t fmav_crc_calculate(const uint8_t* buf, uint16_t len) { (void)buf; (void)len; return 0; }
+static void fmav_crc_accumulate(uint16_t* crc, uint8_t data) { (void)crc; (void)data; }
+static void fmav_crc_accumulate_buf(uint16_t* crc, const uint8_t* buf, uint16_t len) { (void)crc; (void)buf; (void)len; }
+
+class tSerialBase
+{
+  public:
+    bool available(void) { return (pos < len); }
+    char getc(void) { return data[pos++]; }
+
+    std::vector<uint8_t> data;
+    size_t len = 0; // bytes which have arrived so far
+    size_t pos = 0;
+};
+
+#include "Common/mavlink/fmav_extension.h"
+
+
+#define PAYLOAD_LEN       82 // as the Rx frame payload without FEC
+#define MSG_CNT           20000
+#define FRAME_MS          20
+
+
+// appends a random message, returns its length
+static uint16_t add_msg(std::vector<uint8_t>& s)
+{
+    uint8_t kind = rand() % 10;
+    if (kind == 0) { // stray byte, which is not a magic
+        uint8_t c;
+        do { c = rand(); } while (c == 0xFD || c == 0xFE);
+        s.push_back(c);
+        return 1;
+    }
+    uint8_t payload_len = (rand() % 4 == 0) ? rand() % 256 : rand() % 40;
+    uint16_t len;
+    if (kind == 1) { // v1
+        len = 8 + payload_len;
+        s.push_back(0xFE);
+        s.push_back(payload_len);
+        for (uint16_t i = 2; i < len; i++) s.push_back(rand());
+    } else { // v2, sometimes signed
+        bool is_signed = (kind == 2);
+        len = 12 + payload_len + ((is_signed) ? 13 : 0);
+        s.push_back(0xFD);
+        s.push_back(payload_len);
+        s.push_back((is_signed) ? 0x01 : 0x00);
+        for (uint16_t i = 3; i < len; i++) s.push_back(rand());
+    }
+    return len;
+}
+
+
+int main(void)
+{
+tSerialBase serial;
+MavlinkPacker packer;
+std::vector<size_t> msg_start, msg_len;
+std::vector<uint8_t> out;
+uint32_t split_cnt = 0;
+uint32_t frame_cnt = 0;
+
+    srand(1);
+
+    for (uint32_t n = 0; n < MSG_CNT; n++) {
+        msg_start.push_back(serial.data.size());
+        msg_len.push_back(add_msg(serial.data));
+    }
+
+    // a message is split if its first and last byte are in different frames
+    std::vector<uint32_t> frame_of(serial.data.size());
+
+    packer.Init();
+    size_t next_msg = 0;
+    bool half = false;
+    while (out.size() < serial.data.size()) {
+        // a burst of whole messages arrives, sometimes also half of the next message, whose rest then comes
+        // with the next frame, i.e. well within MAVLINK_PACKER_TMO_MS
+        uint8_t burst = rand() % 3;
+        if (half && !burst) burst = 1;
+        half = false;
+        for (uint8_t i = 0; i < burst && next_msg < msg_start.size(); i++) {
+            serial.len = msg_start[next_msg] + msg_len[next_msg];
+            next_msg++;
+        }
+        if (next_msg < msg_start.size() && rand() % 4 == 0) {
+            serial.len = msg_start[next_msg] + msg_len[next_msg] / 2;
+            half = true;
+        }
+        if (next_msg >= msg_start.size()) serial.len = serial.data.size();
+
+        uint8_t payload[PAYLOAD_LEN];
+        uint8_t len = packer.GetPayload(&serial, payload, PAYLOAD_LEN);
+        for (uint8_t i = 0; i < len; i++) {
+            frame_of[out.size()] = frame_cnt;
+            out.push_back(payload[i]);
+        }
+        frame_cnt++;
+        tnow_ms += FRAME_MS;
+        if (frame_cnt > 10 * MSG_CNT) break; // got stuck
+    }
+
+    bool identical = (out.size() == serial.data.size()) && !memcmp(out.data(), serial.data.data(), out.size());
+    for (size_t n = 0; n < msg_start.size() && identical; n++) {
+        if (msg_len[n] > PAYLOAD_LEN) continue;
+        if (frame_of[msg_start[n]] != frame_of[msg_start[n] + msg_len[n] - 1]) split_cnt++;
+    }
+    printf("check: %u messages, %u bytes in %u frames, %s, %u split\n",
+           MSG_CNT, (unsigned)serial.data.size(), frame_cnt, (identical) ? "identical" : "NOT identical", split_cnt);
+
+    // an incomplete message is held back, and handed out after the timeout
+    tSerialBase serial2;
+    serial2.data = { 0xFD, 20, 0, 1, 2, 3, 4, 5, 6, 7 };
+    serial2.len = serial2.data.size();
+    packer.Init();
+    uint8_t payload[PAYLOAD_LEN];
+    uint8_t len1 = packer.GetPayload(&serial2, payload, PAYLOAD_LEN);
+    tnow_ms += MAVLINK_PACKER_TMO_MS / 2;
+    uint8_t len2 = packer.GetPayload(&serial2, payload, PAYLOAD_LEN);
+    tnow_ms += MAVLINK_PACKER_TMO_MS;
+    uint8_t len3 = packer.GetPayload(&serial2, payload, PAYLOAD_LEN);
+    bool tmo_ok = (len1 == 0) && (len2 == 0) && (len3 == serial2.data.size());
+    printf("check: incomplete message handed out after %u bytes, %u bytes, %u bytes, %s\n", len1, len2, len3, (tmo_ok) ? "ok" : "wrong");
+
+    return (identical && !split_cnt && tmo_ok) ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// Reed-Solomon host test
+//*******************************************************
+// checks the codec of Common/libs/reed_solomon.h with the layout of the Tx/Rx frames with USE_FEC
+// the codeword is the 91 bytes frame, with the crc16 placed ahead of the 4 parity bytes
+// - injected byte errors, 1 - 2 must all be repaired
+// - injected bit errors, at random positions and as bursts
+// a frame is accepted only if it decodes and then passes the crc, as in check_txframe(), check_rxframe()
+// a miscorrected frame is then only accepted if the crc16 fails to catch it, with ca 1/65536 probability,
+// which is the same residual as for a corrupted frame without FEC, the test fails if the rate is higher
+// - benchmark of encode and decode
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "Common/libs/crc16.h"
+#include "Common/libs/reed_solomon.h"
+
+
+#define FRAME_LEN         91
+#define FEC_LEN           4
+#define CRC_POS           (FRAME_LEN - FEC_LEN - 2)
+#define TEST_CNT          100000
+#define BENCH_CNT         100000
+#define WRONG_MAX         (4 * TEST_CNT / 65536 + 1) // generous bound on the crc16 residual
+
+
+static void make_codeword(uint8_t* cw)
+{
+    for (uint8_t i = 0; i < CRC_POS; i++) cw[i] = rand();
+    uint16_t crc = crc16_calculate(cw, CRC_POS);
+    cw[CRC_POS] = crc;
+    cw[CRC_POS + 1] = crc >> 8;
+    rs_encode(cw, FRAME_LEN, FEC_LEN);
+}
+
+
+static bool check_codeword(uint8_t* cw)
+{
+    if (!rs_decode(cw, FRAME_LEN, FEC_LEN)) return false;
+    uint16_t crc = crc16_calculate(cw, CRC_POS);
+    return (cw[CRC_POS] == (uint8_t)crc && cw[CRC_POS + 1] == (uint8_t)(crc >> 8));
+}
+
+
+typedef struct {
+    uint32_t repaired;
+    uint32_t rejected;
+    uint32_t wrong; // accepted but not the original
+} tResult;
+
+
+// mode 0: nerr bytes, 1: nerr bits, 2: burst of nerr bits
+static tResult run(uint8_t mode, uint8_t nerr)
+{
+uint8_t cw[FRAME_LEN], cw_org[FRAME_LEN];
+tResult res = {};
+
+    for (uint32_t n = 0; n < TEST_CNT; n++) {
+        make_codeword(cw_org);
+        memcpy(cw, cw_org, FRAME_LEN);
+
+        if (mode == 0) {
+            uint8_t pos[16];
+            for (uint8_t e = 0; e < nerr; e++) {
+                bool again;
+                do { // distinct positions
+                    pos[e] = rand() % FRAME_LEN;
+                    again = false;
+                    for (uint8_t k = 0; k < e; k++) if (pos[k] == pos[e]) again = true;
+                } while (again);
+                cw[pos[e]] ^= 1 + rand() % 255;
+            }
+        } else
+        if (mode == 1) {
+            for (uint8_t e = 0; e < nerr; e++) {
+                uint16_t bit = rand() % (FRAME_LEN * 8);
+                cw[bit / 8] ^= 1 << (bit % 8);
+            }
+        } else {
+            uint16_t bit = rand() % (FRAME_LEN * 8 - nerr);
+            for (uint8_t e = 0; e < nerr; e++, bit++) cw[bit / 8] ^= 1 << (bit % 8);
+        }
+
+        if (!check_codeword(cw)) {
+            res.rejected++;
+        } else
+        if (memcmp(cw, cw_org, FRAME_LEN) == 0) {
+            res.repaired++;
+        } else {
+            res.wrong++;
+        }
+    }
+    return res;
+}
+
+
+int main(void)
+{
+const char* mode_str[3] = { "bytes", "bits", "burst" };
+const uint8_t nerr_list[3][6] = { {1,2,3,4,5,0}, {1,2,3,4,8,16}, {4,8,9,12,16,24} };
+bool failed = false;
+
+    srand(1);
+
+    printf("frame %u bytes, %u parity bytes, %u trials each\n", FRAME_LEN, FEC_LEN, TEST_CNT);
+    for (uint8_t mode = 0; mode < 3; mode++) {
+        for (uint8_t k = 0; k < 6; k++) {
+            uint8_t nerr = nerr_list[mode][k];
+            if (!nerr) continue;
+            tResult res = run(mode, nerr);
+            printf("  %2u %-5s: repaired %6u, rejected %6u, wrong %u\n", nerr, mode_str[mode], res.repaired, res.rejected, res.wrong);
+            if (res.wrong > WRONG_MAX) failed = true;
+            if (mode == 0 && nerr <= FEC_LEN / 2 && res.repaired != TEST_CNT) failed = true;
+            if (mode == 1 && nerr <= FEC_LEN / 2 && res.repaired != TEST_CNT) failed = true;
+        }
+    }
+
+    // benchmark
+    uint8_t cw[FRAME_LEN], cw_org[FRAME_LEN];
+    make_codeword(cw_org);
+    volatile uint8_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < BENCH_CNT; n++) {
+        cw_org[0] = n;
+        rs_encode(cw_org, FRAME_LEN, FEC_LEN);
+        sink = sink + cw_org[FRAME_LEN - 1];
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < BENCH_CNT; n++) {
+        memcpy(cw, cw_org, FRAME_LEN);
+        cw[n % FRAME_LEN] ^= 0x55;
+        cw[(n + 40) % FRAME_LEN] ^= 0xAA;
+        sink = sink + rs_decode(cw, FRAME_LEN, FEC_LEN);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double us_enc = std::chrono::duration<double, std::micro>(t1 - t0).count() / BENCH_CNT;
+    double us_dec = std::chrono::duration<double, std::micro>(t2 - t1).count() / BENCH_CNT;
+    printf("bench: encode %.2f us, decode with 2 errors %.2f us\n", us_enc, us_dec);
+
+    return (failed) ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+#!/usr/bin/env python
+'''
+*******************************************************
+ Copyright (c) MLRS project
+ GPL3
+ https://www.gnu.org/licenses/gpl-3.0.de.html
+ OlliW @ www.olliw.eu
+*******************************************************
+ run_blackbox_summary.py
+ decode and summarize a black box dump of the Tx
+ the dump is obtained with the "bbdump" CLI command, firmware must be compiled with USE_BLACKBOX
+ usage:
+   run_blackbox_summary.py dump.bin            summary
+   run_blackbox_summary.py dump.bin -l         summary and list of all records
+   run_blackbox_summary.py -p COM5 dump.bin    read dump from serial port into file first, requires pyserial
+********************************************************
+'''
+import sys
+import struct
+import argparse
+
+
+RECORD_FORMAT = '<HBBBBbbbbH' # must match tBlackBoxRecord
+RECORD_SIZE = struct.calcsize(RECORD_FORMAT)
+
+RX_STATUS = ['none', 'invalid', 'valid']
+CHECK_RES = {0:'ok', 1:'syncword', 2:'header', 3:'crc1', 4:'crc', 255:'-'}
+RSSI_INVALID = 127
+
+
+#-- helper
+
+def crc8_d5(data):
+    crc = 0
+    for b in data:
+        crc ^= b
+        for i in range(8):
+            crc = ((crc << 1) ^ 0xD5) & 0xFF if (crc & 0x80) else (crc << 1) & 0xFF
+    return crc
+
+
+def read_from_port(port, filename):
+    import serial
+    ser = serial.Serial(port, 115200, timeout=2)
+    ser.write(b'bbdump\n')
+    data = b''
+    while True:
+        d = ser.read(1024)
+        if not d: break
+        data += d
+    ser.close()
+    with open(filename, 'wb') as f:
+        f.write(data)
+
+
+#-- decode
+
+def decode(data):
+    pos = data.find(b'MBB') # the dump follows the CLI echo
+    if pos < 0:
+        raise ValueError('no black box dump found')
+    version = data[pos+3]
+    if version != 1:
+        raise ValueError('unsupported version '+str(version))
+    rec_size, rec_num, frame_rate_ms, mode = struct.unpack_from('<HHHB', data, pos+4)
+    if rec_size != RECORD_SIZE:
+        raise ValueError('record size mismatch')
+    start = pos + 11
+    end = start + rec_size * rec_num
+    if len(data) < end + 1:
+        raise ValueError('dump is truncated')
+    if crc8_d5(data[start:end]) != data[end]:
+        raise ValueError('crc error')
+
+    records = []
+    for i in range(rec_num):
+        (frame_cnt, fhss_i, flags, check_res, payload_len,
+         rssi1, rssi2, snr1, snr2, rx_time_us) = struct.unpack_from(RECORD_FORMAT, data, start + i*rec_size)
+        records.append({
+            'frame_cnt': frame_cnt, 'fhss_i': fhss_i,
+            'rx1_status': flags & 0x03, 'rx2_status': (flags >> 2) & 0x03,
+            'antenna': (flags >> 4) & 0x01, 'connected': (flags >> 5) & 0x01,
+            'check_res': check_res, 'payload_len': payload_len,
+            'rssi1': rssi1, 'rssi2': rssi2, 'snr1': snr1, 'snr2': snr2,
+            'rx_time_us': rx_time_us,
+        })
+    return frame_rate_ms, mode, records
+
+
+#-- summary
+
+def summarize(frame_rate_ms, mode, records):
+    n = len(records)
+    print('frame rate:', frame_rate_ms, 'ms, mode:', mode, ', records:', n, '(', n*frame_rate_ms, 'ms )')
+    if not n: return
+
+    valid = [r for r in records if r['check_res'] == 0]
+    missed = [r for r in records if r['check_res'] == 255]
+    bad = [r for r in records if r['check_res'] not in (0, 255)]
+    print('valid:', len(valid), ' missed:', len(missed), ' invalid:', len(bad))
+
+    # longest run of lost frames
+    run, run_max, run_end = 0, 0, 0
+    for r in records:
+        if r['check_res'] == 0:
+            run = 0
+        else:
+            run += 1
+            if run > run_max: run_max, run_end = run, r['frame_cnt']
+    print('longest loss:', run_max, 'frames, ending at frame', run_end)
+
+    # losses per hop, a few bad channels hint at interference
+    hops = {}
+    for r in records:
+        h = hops.setdefault(r['fhss_i'], [0, 0])
+        h[0] += 1
+        if r['check_res'] != 0: h[1] += 1
+    print('loss per fhss index:')
+    for i in sorted(hops):
+        cnt, lost = hops[i]
+        print('  %2d: %3d%% (%d/%d)' % (i, 100*lost//cnt, lost, cnt))
+
+    # rssi and snr on received frames, fast fading hints at multipath
+    rssi = [r['rssi1'] if r['antenna'] == 0 else r['rssi2'] for r in valid]
+    rssi = [x for x in rssi if x != RSSI_INVALID]
+    if rssi:
+        print('rssi: min', min(rssi), 'max', max(rssi), 'avg', sum(rssi)//len(rssi))
+        steps = [abs(rssi[i] - rssi[i-1]) for i in range(1, len(rssi))]
+        if steps: print('rssi frame to frame change: max', max(steps), 'avg', sum(steps)/len(steps))
+
+    # receive time within the slot, a drift or spread hints at timing problems
+    t = [r['rx_time_us'] for r in valid]
+    if t:
+        print('rx time in slot: min', min(t), 'us, max', max(t), 'us, spread', max(t)-min(t), 'us')
+
+
+def list_records(records):
+    print('frame  hop ant con rx1     rx2     check    len rssi1 rssi2 snr1 snr2 rx_us')
+    for r in records:
+        print('%5d  %3d %3d %3d %-7s %-7s %-8s %3d %5d %5d %4d %4d %5d' % (
+            r['frame_cnt'], r['fhss_i'], r['antenna']+1, r['connected'],
+            RX_STATUS[r['rx1_status']] if r['rx1_status'] < 3 else '?',
+            RX_STATUS[r['rx2_status']] if r['rx2_status'] < 3 else '?',
+            CHECK_RES.get(r['check_res'], '?'), r['payload_len'],
+            r['rssi1'], r['rssi2'], r['snr1'], r['snr2'], r['rx_time_us']))
+
+
+#-- main
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='decode and summarize a mLRS Tx black box dump')
+    parser.add_argument('file', help='dump file')
+    parser.add_argument('-p', '--port', help='read the dump from this serial port into file')
+    parser.add_argument('-l', '--list', action='store_true', help='list all records')
+    args = parser.parse_args()
+
+    if args.port:
+        read_from_port(args.port, args.file)
+
+    with open(args.file, 'rb') as f:
+        data = f.read()
+    try:
+        frame_rate_ms, mode, records = decode(data)
+    except ValueError as e:
+        print('error:', e)
+        sys.exit(1)
+
+    if args.list:
+        list_records(records)
+    summarize(frame_rate_ms, mode, records)
@@ -0,0 +1,84 @@
+#!/usr/bin/env python
+'''
+*******************************************************
+ Copyright (c) MLRS project
+ GPL3
+ https://www.gnu.org/licenses/gpl-3.0.de.html
+ OlliW @ www.olliw.eu
+*******************************************************
+ run_host_tests.py
+ compiles and runs the host tests and benchmarks in tools/host-tests
+ each test is compiled with the host g++, and fails if it returns non-zero
+ usage:
+   run_host_tests.py              run all tests
+   run_host_tests.py crc16        run only tests whose name contains crc16
+   run_host_tests.py -c clang++   use another compiler
+********************************************************
+'''
+import os
+import sys
+import subprocess
+import tempfile
+import argparse
+
+
+mLRSProjectdirectory = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+mLRSdirectory = os.path.join(mLRSProjectdirectory,'mLRS')
+testdirectory = os.path.join(mLRSProjectdirectory,'tools','host-tests')
+
+
+# name, sources, defines
+# sources are relative to mLRS/, except the test source itself
+TESTS = [
+    ['crc16', ['crc16_test.cpp'], []],
+    ['reed_solomon', ['reed_solomon_test.cpp'], []],
+    ['crc8_table', ['crc8_test.cpp', 'Common/thirdparty/thirdparty.cpp'], ['CRC8_USE_TABLE']],
+    ['crc8_nibble', ['crc8_test.cpp', 'Common/thirdparty/thirdparty.cpp'], ['CRC8_USE_NIBBLE_TABLE']],
+    ['crc8_bitwise', ['crc8_test.cpp', 'Common/thirdparty/thirdparty.cpp'], ['CRC8_USE_BITWISE']],
+    ['mavlink_packer', ['mavlink_packer_test.cpp'], []],
+]
+
+
+def run_test(compiler, name, sources, defines, builddir):
+    exe = os.path.join(builddir, name)
+    cmd = [compiler, '-O2', '-std=c++11', '-Wall', '-I'+mLRSdirectory, '-o', exe]
+    for d in defines:
+        cmd.append('-D'+d)
+    for s in sources:
+        if s.endswith('_test.cpp'):
+            cmd.append(os.path.join(testdirectory, s))
+        else:
+            cmd.append(os.path.join(mLRSdirectory, s))
+    print('--', name)
+    if subprocess.call(cmd) != 0:
+        print('-- '+name+': compile FAILED')
+        return False
+    if subprocess.call([exe]) != 0:
+        print('-- '+name+': FAILED')
+        return False
+    print('-- '+name+': ok')
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description='run the host tests and benchmarks')
+    parser.add_argument('filter', nargs='?', default='', help='run only tests whose name contains this')
+    parser.add_argument('-c', '--compiler', default='g++', help='compiler, default g++')
+    args = parser.parse_args()
+
+    failed = []
+    with tempfile.TemporaryDirectory() as builddir:
+        for name, sources, defines in TESTS:
+            if args.filter not in name: continue
+            if not run_test(args.compiler, name, sources, defines, builddir):
+                failed.append(name)
+
+    print()
+    if failed:
+        print('FAILED: '+', '.join(failed))
+        sys.exit(1)
+    print('all ok')
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,501 @@
+#!/usr/bin/env python
+'''
+*******************************************************
+ Copyright (c) MLRS project
+ GPL3
+ https://www.gnu.org/licenses/gpl-3.0.de.html
+ OlliW @ www.olliw.eu
+*******************************************************
+ run_txbuf_simulation.py
+ simulation of the RADIO_STATUS txbuf flow control of the Rx, with models of the ArduPilot and PX4
+ stream rate responses
+ evaluates buffer occupancy, goodput and oscillation for each mode and baudrate, for the txbuf state
+ machines (legacy) and the controller of USE_MAVLINK_TXBUF_CONTROLLER (ctrl)
+ the scenario is streams only, then a param download, then streams only again
+ usage:
+   run_txbuf_simulation.py                    all modes, baudrates, autopilots and methods
+   run_txbuf_simulation.py -m 19 -b 57600     selected mode and baudrate
+   run_txbuf_simulation.py -a px4 -c ctrl     selected autopilot and method
+   run_txbuf_simulation.py -t 120 -v          longer simulation time, print a trace once per sec
+********************************************************
+'''
+import argparse
+import math
+
+
+MODES = { # frame rate ms, rx payload len, as in setup.h, without FEC
+    50: (20, 82),
+    31: (32, 82),
+    19: (53, 82),
+}
+BAUDRATES = [57600, 115200, 230400]
+
+RX_SERIAL_RXBUFSIZE = 2048 # common_conf.h
+FC_TXBUF_SIZE = 512 # serial tx buffer of the flight controller
+
+# streams of a typical telemetry setup, frame len incl. MAVLink v2 overhead, rate in Hz
+STREAMS = [
+    ('ATTITUDE', 40, 10), ('GLOBAL_POSITION_INT', 40, 10), ('VFR_HUD', 32, 10), ('AHRS', 36, 10),
+    ('SYS_STATUS', 55, 4), ('GPS_RAW_INT', 64, 4), ('RC_CHANNELS', 54, 4), ('SERVO_OUTPUT_RAW', 49, 4),
+    ('NAV_CONTROLLER_OUTPUT', 38, 4), ('MISSION_CURRENT', 30, 4), ('POWER_STATUS', 18, 4),
+    ('MEMINFO', 16, 4), ('BATTERY_STATUS', 48, 4), ('VIBRATION', 44, 4), ('EKF_STATUS_REPORT', 38, 4),
+    ('HEARTBEAT', 21, 1), ('SYSTEM_TIME', 24, 1),
+]
+PARAM_VALUE_LEN = 37
+PARAM_NUM = 1000
+PARAM_START_S = 10
+TAIL_S = 30 # streams and oscillation are evaluated in the last secs, after the param download
+
+
+#-- controller, must match mavlink_txbuf_controller.h
+
+TXBUF_CTRL_PERIOD_MS = 250
+TXBUF_CTRL_PERIOD_MIN_MS = 50
+TXBUF_CTRL_RATE_T_MS = 1000
+TXBUF_CTRL_RATE_TARGET_PCT = 85
+TXBUF_CTRL_DELAY_TARGET_MS = 200
+TXBUF_CTRL_DRAIN_MS = 1000
+TXBUF_CTRL_DELAY_PARAMS_MS = 300
+TXBUF_CTRL_U_WEAK_PM = 100
+TXBUF_CTRL_U_STRONG_PM = 300
+TXBUF_CTRL_CAPACITY_REF_BPS = 5000
+
+
+def cdiv(a, b): # C integer division, rounds towards zero
+    q = abs(a) // abs(b)
+    return q if (a >= 0) == (b >= 0) else -q
+
+
+class LPFilterRate: # filters.cpp
+
+    def __init__(self):
+        self.Reset()
+
+    def Reset(self):
+        self.xlast = 0
+        self.tlast_ms = 0
+        self.filt_internal = 0
+        self.state = 0
+
+    def Update(self, tnow_ms, x, T_ms):
+        if self.state > 1:
+            xdiff = (x - self.xlast) * 1000
+            tdiff_ms = tnow_ms - self.tlast_ms
+            self.filt_internal += cdiv(xdiff - self.filt_internal * tdiff_ms, T_ms + tdiff_ms)
+        elif self.state == 0:
+            self.filt_internal = 0
+            self.state += 1
+        elif self.state == 1:
+            xdiff = (x - self.xlast) * 1000
+            tdiff_ms = tnow_ms - self.tlast_ms
+            self.filt_internal = cdiv(xdiff, tdiff_ms)
+            self.state += 1
+        self.xlast = x
+        self.tlast_ms = tnow_ms
+
+    def Get(self):
+        return self.filt_internal
+
+
+class TxbufController:
+
+    def __init__(self):
+        self.rate_control = True
+        self.tlast_ms = 0
+        self.rate_filt = LPFilterRate()
+        self.rate_bps = 0
+        self.delay_ms = 0
+        self.u_pm = 0
+        self.level = 0
+        self.params_cut = False
+
+    def Update(self, tnow_ms, bytes_cnt, queue_len, capacity_bps):
+        self.delay_ms = (queue_len * 1000) // capacity_bps
+
+        if (tnow_ms - self.tlast_ms) < TXBUF_CTRL_PERIOD_MS:
+            # cut params immediately when the queue builds up, so that a param burst doesn't fill the buffer
+            if (not self.params_cut and self.delay_ms > TXBUF_CTRL_DELAY_PARAMS_MS and
+                (tnow_ms - self.tlast_ms) >= TXBUF_CTRL_PERIOD_MIN_MS):
+                self.params_cut = True
+                self.level = 0 # only cut the params, the streams are handled with the next period
+                return True
+            return False
+        self.tlast_ms = tnow_ms
+
+        scale_pm = max((TXBUF_CTRL_CAPACITY_REF_BPS * 1000) // capacity_bps, 1000)
+
+        self.rate_filt.Update(tnow_ms, bytes_cnt, (TXBUF_CTRL_RATE_T_MS * scale_pm) // 1000)
+        self.rate_bps = self.rate_filt.Get()
+
+        rate_err_pm = 0
+        if self.rate_control and self.rate_filt.state > 1:
+            rate_err_pm = cdiv((self.rate_bps - (capacity_bps * TXBUF_CTRL_RATE_TARGET_PCT) // 100) * 1000, capacity_bps)
+        delay_err_ms = max(self.delay_ms - TXBUF_CTRL_DELAY_TARGET_MS, 0)
+
+        self.u_pm = rate_err_pm + (delay_err_ms * 1000) // TXBUF_CTRL_DRAIN_MS
+
+        u_weak_pm = min((TXBUF_CTRL_U_WEAK_PM * scale_pm) // 1000, TXBUF_CTRL_U_STRONG_PM)
+
+        if self.u_pm > TXBUF_CTRL_U_STRONG_PM: self.level = 2
+        elif self.u_pm > u_weak_pm: self.level = 1
+        elif self.u_pm < -TXBUF_CTRL_U_STRONG_PM: self.level = -2
+        elif self.u_pm < -u_weak_pm: self.level = -1
+        else: self.level = 0
+        self.params_cut = self.delay_ms > TXBUF_CTRL_DELAY_PARAMS_MS
+        return True
+
+    def Txbuf(self, autopilot):
+        if autopilot == 'ardupilot':
+            txbuf = {2:0, 1:30, -1:91, -2:100}
+            return txbuf.get(self.level, 50 if self.params_cut else 60)
+        txbuf = {2:0, 1:30, -1:100, -2:100}
+        return txbuf.get(self.level, 33 if self.params_cut else 40)
+
+
+#-- legacy state machines, as handle_txbuf_ardupilot() and handle_txbuf_method_b() in mavlink_interface_rx.h
+
+TXBUF_STATE_NORMAL, TXBUF_STATE_BURST, TXBUF_STATE_BURST_HIGH, TXBUF_STATE_PX4_RECOVER = 0, 1, 2, 3
+
+
+def rate_txbuf(rate_percentage):
+    if rate_percentage > 95: return 0
+    if rate_percentage > 85: return 30
+    if rate_percentage < 60: return 100
+    if rate_percentage < 75: return 91
+    return 50
+
+
+class LegacyArduPilot:
+
+    def __init__(self):
+        self.tlast_ms = 1000
+        self.state = TXBUF_STATE_NORMAL
+        self.bytes_serial_in = 0
+
+    def Update(self, tnow_ms, available, rate_max, payload_len):
+        inject = False
+        state_last = self.state
+        if (tnow_ms - self.tlast_ms) >= 1000:
+            self.tlast_ms = tnow_ms
+            inject = True
+        elif (tnow_ms - self.tlast_ms) >= 100:
+            if self.state == TXBUF_STATE_NORMAL:
+                if available > 1024:
+                    self.state = TXBUF_STATE_BURST
+                    self.tlast_ms = tnow_ms
+                    inject = True
+            elif self.state == TXBUF_STATE_BURST:
+                if available > 1024:
+                    self.state = TXBUF_STATE_BURST_HIGH
+                    self.tlast_ms = tnow_ms
+                    inject = True
+                elif available < 384:
+                    self.state = TXBUF_STATE_NORMAL
+                    self.tlast_ms = tnow_ms
+                    inject = True
+            elif self.state == TXBUF_STATE_BURST_HIGH:
+                if available < 1024:
+                    self.state = TXBUF_STATE_BURST
+                self.tlast_ms = tnow_ms
+                inject = True
+        if not inject: return None
+
+        txbuf = rate_txbuf((self.bytes_serial_in * 100) // rate_max)
+        if self.state == TXBUF_STATE_BURST_HIGH:
+            txbuf = 0
+        elif self.state == TXBUF_STATE_BURST:
+            txbuf = 50
+        elif self.state == TXBUF_STATE_NORMAL and state_last > TXBUF_STATE_NORMAL:
+            txbuf = 51
+
+        if self.state == TXBUF_STATE_NORMAL and txbuf == 100:
+            self.tlast_ms -= 666
+            self.bytes_serial_in = (self.bytes_serial_in * 2) // 3
+        else:
+            self.bytes_serial_in = 0
+        return txbuf
+
+
+class LegacyMethodB:
+
+    def __init__(self):
+        self.tlast_ms = 1000
+        self.state = TXBUF_STATE_NORMAL
+        self.bytes_serial_in = 0
+
+    def Update(self, tnow_ms, available, rate_max, payload_len):
+        inject = False
+        if (tnow_ms - self.tlast_ms) >= 1000:
+            self.tlast_ms = tnow_ms
+            inject = True
+        elif self.state == TXBUF_STATE_NORMAL:
+            if available > 800:
+                self.state = TXBUF_STATE_BURST
+                self.tlast_ms = tnow_ms
+                inject = True
+        elif self.state == TXBUF_STATE_BURST:
+            if available > 1400:
+                self.state = TXBUF_STATE_BURST_HIGH
+                self.tlast_ms = tnow_ms
+                inject = True
+            elif available < payload_len * 2:
+                self.state = TXBUF_STATE_PX4_RECOVER
+                self.tlast_ms = tnow_ms
+                inject = True
+        elif self.state == TXBUF_STATE_BURST_HIGH:
+            if (tnow_ms - self.tlast_ms) >= 100:
+                if available < 1400:
+                    self.state = TXBUF_STATE_BURST
+                self.tlast_ms = tnow_ms
+                inject = True
+        elif self.state == TXBUF_STATE_PX4_RECOVER:
+            self.state = TXBUF_STATE_NORMAL
+        if not inject: return None
+
+        txbuf = 100
+        if self.state == TXBUF_STATE_NORMAL:
+            txbuf = rate_txbuf((self.bytes_serial_in * 100) // rate_max)
+        elif self.state == TXBUF_STATE_BURST:
+            txbuf = 33
+        elif self.state == TXBUF_STATE_BURST_HIGH:
+            txbuf = 0
+        elif self.state == TXBUF_STATE_PX4_RECOVER:
+            txbuf = 93
+
+        if self.state == TXBUF_STATE_NORMAL and txbuf == 100:
+            self.tlast_ms -= 800
+            self.bytes_serial_in = (self.bytes_serial_in * 4) // 5
+        else:
+            self.bytes_serial_in = 0
+        return txbuf
+
+
+#-- autopilot models
+
+class ArduPilot:
+    # GCS_MAVLINK::handle_radio_status(), streams are send in buckets, the interval of each
+    # bucket is extended by stream_slowdown_ms, params are send only if txbuf > 50
+    param_txbuf_min = 51
+
+    def __init__(self):
+        self.stream_slowdown_ms = 0
+        self.last_txbuf = 100
+
+    def radio_status(self, txbuf):
+        self.last_txbuf = txbuf
+        if txbuf < 20:
+            self.stream_slowdown_ms += 60
+        elif txbuf < 50:
+            self.stream_slowdown_ms += 20
+        elif txbuf > 95 and self.stream_slowdown_ms > 200:
+            self.stream_slowdown_ms -= 40
+        elif txbuf > 90 and self.stream_slowdown_ms != 0:
+            self.stream_slowdown_ms -= 20
+        self.stream_slowdown_ms = min(max(self.stream_slowdown_ms, 0), 2000)
+
+    def interval_ms(self, rate_hz):
+        return 1000.0 / rate_hz + self.stream_slowdown_ms
+
+    def knob(self):
+        return self.stream_slowdown_ms
+
+
+class PX4:
+    # Mavlink::update_radio_status(), the rates of all streams are scaled by a common factor
+    param_txbuf_min = 35
+
+    def __init__(self):
+        self.rate_mult = 1.0
+        self.last_txbuf = 100
+
+    def radio_status(self, txbuf):
+        self.last_txbuf = txbuf
+        if txbuf < 25:
+            self.rate_mult *= 0.8
+        elif txbuf < 35:
+            self.rate_mult *= 0.975
+        elif txbuf > 50:
+            self.rate_mult *= 1.025
+        self.rate_mult = min(max(self.rate_mult, 0.05), 1.0)
+
+    def interval_ms(self, rate_hz):
+        return 1000.0 / (rate_hz * self.rate_mult)
+
+    def knob(self):
+        return int(self.rate_mult * 1000)
+
+
+#-- simulation
+
+def simulate(mode, baudrate, autopilot, method, tsim_s, verbose=False):
+    frame_rate_ms, payload_len = MODES[mode]
+    capacity_bps = (1000 * payload_len) // frame_rate_ms
+    serial_bytes_per_ms = baudrate / 10000.0
+
+    ap = ArduPilot() if autopilot == 'ardupilot' else PX4()
+    if method == 'ctrl':
+        ctrl = TxbufController()
+    elif autopilot == 'ardupilot':
+        ctrl = LegacyArduPilot()
+    else:
+        ctrl = LegacyMethodB()
+
+    stream_tnext = [i * 0.3 for i in range(len(STREAMS))] # start them slightly apart
+    fc_txq = [] # list of [len, is_param]
+    fc_txq_len = 0
+    serial_credit = 0.0
+    param_credit = 0.0
+    params_send = 0
+    params_done_ms = None
+
+    rx_queue = [] # list of [len, is_param], bytes waiting in the Rx serial buffer
+    rx_queue_len = 0
+    overflow = 0
+    bytes_serial_in_cnt = 0
+    link_bytes = 0
+
+    queue_sum = 0
+    queue_max = 0
+    knob_last = ap.knob()
+    knob_dir = 0
+    reversals = 0
+    sec_stream_bytes = 0
+    sec_rates = []
+    txbuf_cnt = 0
+
+    tail_ms = (tsim_s - TAIL_S) * 1000
+    for tnow_ms in range(tsim_s * 1000):
+        # autopilot puts streams into its tx buffer, if there is space
+        for i, (name, length, rate_hz) in enumerate(STREAMS):
+            if tnow_ms < stream_tnext[i]: continue
+            if fc_txq_len + length > FC_TXBUF_SIZE: continue # is deferred
+            fc_txq.append([length, False])
+            fc_txq_len += length
+            stream_tnext[i] += ap.interval_ms(rate_hz)
+            if stream_tnext[i] < tnow_ms: stream_tnext[i] = tnow_ms
+        # params, at most 30% of the serial bandwidth
+        if tnow_ms >= PARAM_START_S * 1000 and params_send < PARAM_NUM:
+            param_credit = min(param_credit + 0.3 * serial_bytes_per_ms, PARAM_VALUE_LEN)
+            if (ap.last_txbuf >= ap.param_txbuf_min and param_credit >= PARAM_VALUE_LEN and
+                fc_txq_len + PARAM_VALUE_LEN <= FC_TXBUF_SIZE):
+                fc_txq.append([PARAM_VALUE_LEN, True])
+                fc_txq_len += PARAM_VALUE_LEN
+                param_credit -= PARAM_VALUE_LEN
+                params_send += 1
+
+        # serial from flight controller into Rx serial buffer
+        serial_credit = min(serial_credit + serial_bytes_per_ms, 64)
+        while fc_txq and serial_credit >= 1:
+            n = min(int(serial_credit), fc_txq[0][0])
+            fc_txq[0][0] -= n
+            fc_txq_len -= n
+            serial_credit -= n
+            if rx_queue_len + n > RX_SERIAL_RXBUFSIZE:
+                overflow += rx_queue_len + n - RX_SERIAL_RXBUFSIZE
+                n = RX_SERIAL_RXBUFSIZE - rx_queue_len
+            if n > 0:
+                if rx_queue and rx_queue[-1][2] == 0 and rx_queue[-1][1] == fc_txq[0][1]:
+                    rx_queue[-1][0] += n # same message continues
+                else:
+                    rx_queue.append([n, fc_txq[0][1], 0])
+                rx_queue_len += n
+            if fc_txq[0][0] == 0:
+                if rx_queue: rx_queue[-1][2] = 1 # message complete
+                fc_txq.pop(0)
+
+        # link takes a frame payload out of the Rx serial buffer
+        if tnow_ms % frame_rate_ms == 0:
+            n = min(payload_len, rx_queue_len)
+            rx_queue_len -= n
+            bytes_serial_in_cnt += n
+            link_bytes += n
+            if hasattr(ctrl, 'bytes_serial_in'): ctrl.bytes_serial_in += n
+            while n > 0 and rx_queue:
+                m = min(n, rx_queue[0][0])
+                rx_queue[0][0] -= m
+                n -= m
+                if not rx_queue[0][1]:
+                    sec_stream_bytes += m
+                if rx_queue[0][0] == 0: rx_queue.pop(0)
+
+        # Rx flow control
+        txbuf = None
+        if method == 'ctrl':
+            if ctrl.Update(tnow_ms, bytes_serial_in_cnt + rx_queue_len, rx_queue_len, capacity_bps):
+                txbuf = ctrl.Txbuf(autopilot)
+        else:
+            rate_max = (1000 * payload_len) // frame_rate_ms
+            txbuf = ctrl.Update(tnow_ms, rx_queue_len, rate_max, payload_len)
+        if txbuf is not None:
+            ap.radio_status(txbuf)
+            txbuf_cnt += 1
+            k = ap.knob()
+            d = (k > knob_last) - (k < knob_last)
+            if d != 0:
+                if knob_dir != 0 and d != knob_dir and tnow_ms >= tail_ms: reversals += 1
+                knob_dir = d
+            knob_last = k
+
+        if params_send >= PARAM_NUM and params_done_ms is None and not any(p for _, p, _ in rx_queue):
+            params_done_ms = tnow_ms
+
+        queue_sum += rx_queue_len
+        queue_max = max(queue_max, rx_queue_len)
+        if tnow_ms % 1000 == 999:
+            if tnow_ms >= tail_ms: sec_rates.append(sec_stream_bytes)
+            if verbose:
+                print('  %3d s: queue %4d, stream %5d B/s, params %4d, knob %4d' %
+                      (tnow_ms // 1000, rx_queue_len, sec_stream_bytes, params_send, ap.knob()))
+            sec_stream_bytes = 0
+
+    n = len(sec_rates)
+    mean = sum(sec_rates) / n if n else 0
+    std = math.sqrt(sum((r - mean)**2 for r in sec_rates) / n) if n else 0
+    return {
+        'capacity': capacity_bps,
+        'queue_avg': queue_sum / (tsim_s * 1000),
+        'queue_max': queue_max,
+        'delay_avg_ms': 1000.0 * queue_sum / (tsim_s * 1000) / capacity_bps,
+        'overflow': overflow,
+        'goodput_pct': 100.0 * link_bytes / (tsim_s * capacity_bps),
+        'stream_bps': mean,
+        'stream_cv_pct': 100.0 * std / mean if mean else 0,
+        'reversals_per_min': reversals * 60.0 / TAIL_S,
+        'params_s': (params_done_ms / 1000.0 - PARAM_START_S) if params_done_ms is not None else None,
+    }
+
+
+#-- main
+
+def main():
+    parser = argparse.ArgumentParser(description='simulation of the txbuf flow control')
+    parser.add_argument('-m', '--mode', type=int, choices=list(MODES.keys()), help='mode, 50, 31 or 19')
+    parser.add_argument('-b', '--baudrate', type=int, help='serial baudrate')
+    parser.add_argument('-a', '--autopilot', choices=['ardupilot', 'px4'])
+    parser.add_argument('-c', '--method', choices=['legacy', 'ctrl'])
+    parser.add_argument('-t', '--time', type=int, default=90, help='simulation time in sec')
+    parser.add_argument('-v', '--verbose', action='store_true')
+    args = parser.parse_args()
+
+    modes = [args.mode] if args.mode else list(MODES.keys())
+    baudrates = [args.baudrate] if args.baudrate else BAUDRATES
+    autopilots = [args.autopilot] if args.autopilot else ['ardupilot', 'px4']
+    methods = [args.method] if args.method else ['legacy', 'ctrl']
+
+    print('streams: %d B/s, params: %d x %d B from %d s' %
+          (sum(l * r for _, l, r in STREAMS), PARAM_NUM, PARAM_VALUE_LEN, PARAM_START_S))
+    print('mode baud   autopilot method | capacity | queue avg  max  delay | overflow | goodput | streams  cv  | reversals | params')
+    for mode in modes:
+        for baudrate in baudrates:
+            for autopilot in autopilots:
+                for method in methods:
+                    r = simulate(mode, baudrate, autopilot, method, args.time, args.verbose)
+                    print('%2d Hz %6d %-9s %-6s | %5d B/s | %5d %5d %5d ms | %8d | %5.1f %% | %5d B/s %3d %% | %5.1f /min | %s' % (
+                        mode, baudrate, autopilot, method, r['capacity'],
+                        r['queue_avg'], r['queue_max'], r['delay_avg_ms'], r['overflow'],
+                        r['goodput_pct'], r['stream_bps'], r['stream_cv_pct'], r['reversals_per_min'],
+                        '%.1f s' % r['params_s'] if r['params_s'] is not None else '-'))
+
+
+if __name__ == "__main__":
+    main()